@@ -18,20 +18,28 @@ struct StaticConf
 	static constexpr unsigned MAX_TASKS = 10;
 	static constexpr unsigned MAX_WAITABLE_OBJECTS = 10;
 	static constexpr unsigned MAX_WAIT_OBJECTS = 10;
+	static constexpr unsigned MAX_REMOTE_TASKS = 8; // has to be a power of two
 
 	using CONTAINER_TASKS            = Tools::static_vector<yield_type*,MAX_TASKS>;
 	using CONTAINER_WAITABLE_OBJECTS = Tools::static_vector<CoScheduler::WaitForBase*,MAX_WAITABLE_OBJECTS>;
 	using CONTAINER_WAIT_OBJECTS     = Tools::static_vector<CoScheduler::WaitForBase*,MAX_WAIT_OBJECTS>;
+	using CONTAINER_REMOTE_TASKS     = CoScheduler::Inbox<yield_type*,MAX_REMOTE_TASKS>;
+
+	using IDLE_WAITER = CoScheduler::IdleWaiter;
 
 
 	/*
 	 * idle function, this is for testing on the pc,
-	 * on a microcontroller, you may do nothing here
+	 * on a microcontroller, you may do nothing here.
+	 * The waiter returns early, if a task is added from an other thread.
+	 *
+	 * timeout is the time till the next task has to run, at most 10ms
+	 * (Conf::MAX_IDLE), so objects changed by other threads, without
+	 * calling wakeup(), are noticed after 10ms.
 	 */
-	inline static void idle()
+	inline static void idle( IDLE_WAITER & waiter, std::chrono::nanoseconds timeout )
 	{
-		using namespace std::chrono_literals;
-		std::this_thread::sleep_for( 10ms );
+		waiter.wait_for( timeout );
 	}
 };
 
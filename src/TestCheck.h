@@ -0,0 +1,42 @@
+/**
+ * Checks for the test programs, the exit code tells, if all passed
+ * @author Copyright (c) 2024 Martin Oberzalek
+ */
+#pragma once
+#ifndef SRC_TESTCHECK_H_
+#define SRC_TESTCHECK_H_
+
+#include <iostream>
+#include <string>
+#include <OutDebug.h>
+
+namespace TestCheck {
+
+inline int failures = 0;
+
+inline bool check( bool condition, const std::string & what )
+{
+	if( !condition ) {
+		std::cout << "FAILED: " << what << std::endl;
+		failures++;
+	} else {
+		CPPDEBUG( "ok: " + what );
+	}
+
+	return condition;
+}
+
+// return value for main()
+inline int result()
+{
+	if( failures ) {
+		std::cout << failures << " checks failed" << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
+
+} // namespace TestCheck
+
+#endif /* SRC_TESTCHECK_H_ */
@@ -0,0 +1,137 @@
+/**
+ * Formatting of timestamps for debug output
+ * @author Copyright (c) 2023 - 2024 Martin Oberzalek
+ */
+#pragma once
+
+#include <string>
+#include <chrono>
+#include <cstddef>
+#include "date.h"
+
+/**
+ * Formats timestamps as HH:MM:SS.mmmm or HH:MM:SS
+ * into a buffer provided by the caller, without heap usage.
+ *
+ * The date calculation and the HH:MM: part are only done once per
+ * minute, all other calls only write the seconds and milliseconds.
+ *
+ * An instance must not be shared between threads,
+ * use thread_instance() to get one per thread.
+ */
+class TimestampFormatter
+{
+public:
+	using clock = std::chrono::system_clock;
+
+	static constexpr std::size_t HHMMSSMS_LEN = 13;	// "HH:MM:SS.mmmm"
+	static constexpr std::size_t HHMMSS_LEN = 8;	// "HH:MM:SS"
+
+private:
+	clock::time_point minute_start{};
+	clock::time_point minute_end{};
+	char prefix[6] = { '0', '0', ':', '0', '0', ':' };
+
+public:
+	static TimestampFormatter & thread_instance()
+	{
+		thread_local TimestampFormatter formatter;
+		return formatter;
+	}
+
+	/**
+	 * buffer has to hold at least HHMMSSMS_LEN + 1 bytes
+	 * returns the length of the string, or 0 if the buffer is too small
+	 */
+	std::size_t format_hhmmssms( const clock::time_point tp, char *buffer, std::size_t size )
+	{
+		if( size < HHMMSSMS_LEN + 1 ) {
+			return 0;
+		}
+
+		const unsigned ms = format_prefix( tp, buffer );
+
+		buffer[8] = '.';
+		write_digits( buffer + 9, 4, ms % 1000 );
+		buffer[HHMMSSMS_LEN] = '\0';
+
+		return HHMMSSMS_LEN;
+	}
+
+	/**
+	 * buffer has to hold at least HHMMSS_LEN + 1 bytes
+	 * returns the length of the string, or 0 if the buffer is too small
+	 */
+	std::size_t format_hhmmss( const clock::time_point tp, char *buffer, std::size_t size )
+	{
+		if( size < HHMMSS_LEN + 1 ) {
+			return 0;
+		}
+
+		format_prefix( tp, buffer );
+		buffer[HHMMSS_LEN] = '\0';
+
+		return HHMMSS_LEN;
+	}
+
+private:
+	/**
+	 * writes HH:MM:SS and returns the milliseconds within the minute
+	 */
+	unsigned format_prefix( const clock::time_point tp, char *buffer )
+	{
+		using namespace std::chrono;
+
+		if( tp < minute_start || tp >= minute_end ) {
+			update_prefix( tp );
+		}
+
+		const unsigned ms = static_cast<unsigned>( duration_cast<milliseconds>( tp - minute_start ).count() );
+
+		for( std::size_t i = 0; i < sizeof(prefix); i++ ) {
+			buffer[i] = prefix[i];
+		}
+
+		write_digits( buffer + 6, 2, ms / 1000 );
+
+		return ms;
+	}
+
+	void update_prefix( const clock::time_point tp )
+	{
+		using namespace std::chrono;
+
+		const auto dp = date::floor<date::days>(tp);
+		const auto since_midnight = floor<minutes>( tp - dp );
+
+		minute_start = dp + since_midnight;
+		minute_end = minute_start + minutes( 1 );
+
+		write_digits( prefix, 2, static_cast<unsigned>( since_midnight.count() / 60 ) );
+		write_digits( prefix + 3, 2, static_cast<unsigned>( since_midnight.count() % 60 ) );
+	}
+
+	static void write_digits( char *dest, std::size_t digits, unsigned value )
+	{
+		for( std::size_t i = digits; i > 0; i-- ) {
+			dest[i-1] = static_cast<char>( '0' + value % 10 );
+			value /= 10;
+		}
+	}
+};
+
+inline std::string to_hhmmssms( const std::chrono::time_point<std::chrono::system_clock> tp )
+{
+	char buffer[TimestampFormatter::HHMMSSMS_LEN + 1];
+	const std::size_t len = TimestampFormatter::thread_instance().format_hhmmssms( tp, buffer, sizeof(buffer) );
+
+	return std::string( buffer, len );
+}
+
+inline std::string to_hhmmss( const std::chrono::time_point<std::chrono::system_clock> tp )
+{
+	char buffer[TimestampFormatter::HHMMSS_LEN + 1];
+	const std::size_t len = TimestampFormatter::thread_instance().format_hhmmss( tp, buffer, sizeof(buffer) );
+
+	return std::string( buffer, len );
+}
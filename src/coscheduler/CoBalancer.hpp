@@ -0,0 +1,207 @@
+/**
+ * Load balancing between scheduler shards (linux only)
+ * @author Copyright (c) 2024 Martin Oberzalek
+ */
+#pragma once
+#ifndef SRC_COSCHEDULER_COBALANCER_HPP_
+#define SRC_COSCHEDULER_COBALANCER_HPP_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "CoScheduler.hpp"
+#include "CoShard.hpp"
+
+namespace CoScheduler {
+
+/**
+ * Busy time of one shard, since the last balance() call
+ */
+struct ShardLoad
+{
+	unsigned id = 0;
+	std::chrono::nanoseconds busy{};
+	std::size_t tasks = 0;
+};
+
+/**
+ * Migration policy of the LoadBalancer.
+ *
+ * plan() decides between which shards tasks are moved,
+ * select() (see MigrationSelector) is called later in the source
+ * shard, for each task, that could be moved.
+ */
+class BalancePolicy : public MigrationSelector
+{
+public:
+	/**
+	 * period is the time since the last call, utilization is the
+	 * share of a core, that should be moved from one shard to the other.
+	 * returns false, if nothing should be done
+	 */
+	virtual bool plan( const std::vector<ShardLoad> & loads,
+					   std::chrono::nanoseconds period,
+					   unsigned & from,
+					   unsigned & to,
+					   double & utilization ) const = 0;
+};
+
+/**
+ * Moves periodic tasks from the busiest to the idlest shard,
+ * if the difference of their utilization is above threshold.
+ * Half of the difference is moved per round.
+ */
+class DefaultBalancePolicy : public BalancePolicy
+{
+	const double threshold;
+	const std::uint64_t min_resumes;
+
+public:
+	/**
+	 * threshold:   difference of the utilization, 0.2 means 20% of the period
+	 * min_resumes: only tasks, that have been resumed this often are moved,
+	 *              so short running tasks are not moved around
+	 */
+	DefaultBalancePolicy( double threshold_ = 0.2, std::uint64_t min_resumes_ = 10 )
+	: threshold( threshold_ ),
+	  min_resumes( min_resumes_ )
+	{}
+
+	bool plan( const std::vector<ShardLoad> & loads,
+			   std::chrono::nanoseconds period,
+			   unsigned & from,
+			   unsigned & to,
+			   double & utilization ) const override
+	{
+		if( loads.size() < 2 || period.count() <= 0 ) {
+			return false;
+		}
+
+		std::size_t busiest = 0;
+		std::size_t idlest = 0;
+
+		for( std::size_t i = 1; i < loads.size(); i++ ) {
+			if( loads[i].busy > loads[busiest].busy ) {
+				busiest = i;
+			}
+
+			if( loads[i].busy < loads[idlest].busy ) {
+				idlest = i;
+			}
+		}
+
+		const double diff = static_cast<double>( ( loads[busiest].busy - loads[idlest].busy ).count() ) /
+							static_cast<double>( period.count() );
+
+		if( diff < threshold ) {
+			return false;
+		}
+
+		from = loads[busiest].id;
+		to = loads[idlest].id;
+		utilization = diff / 2;
+
+		return true;
+	}
+
+	bool select( const YIELD & value, double remaining ) const override
+	{
+		return value.stats.resumes >= min_resumes &&
+			   task_utilization( value ) <= remaining;
+	}
+};
+
+/**
+ * Periodically compares the busy time of the shards and asks
+ * the busiest one to hand over tasks, see Shard::request_migration().
+ *
+ *   CoScheduler::ShardGroup<DynamicConf> shards;
+ *   CoScheduler::LoadBalancer<DynamicConf> balancer( shards );
+ *
+ *   shards.spawn( 0, [&balancer]() {
+ *     return balancer.task<Scheduler::yield_type>( 1s );
+ *   });
+ *
+ * The tasks are moved by the source shard at the start of its
+ * next schedule() run, so they are always moved, while they
+ * are suspended in co_yield.
+ *
+ * balance() may be called from any thread, but only from one at a time.
+ */
+template<class Conf> class LoadBalancer
+{
+	ShardGroup<Conf> & shards;
+	DefaultBalancePolicy default_policy;
+	const BalancePolicy & policy;
+	std::vector<std::chrono::nanoseconds> last_busy;
+	YIELD::timepoint_t last_run{};
+
+public:
+	LoadBalancer( ShardGroup<Conf> & shards_ )
+	: LoadBalancer( shards_, default_policy )
+	{}
+
+	/**
+	 * the policy has to stay valid, as long as the balancer exists
+	 */
+	LoadBalancer( ShardGroup<Conf> & shards_, const BalancePolicy & policy_ )
+	: shards( shards_ ),
+	  policy( policy_ ),
+	  last_busy( shards_.size() )
+	{}
+
+	LoadBalancer( const LoadBalancer & other ) = delete;
+	LoadBalancer & operator=( const LoadBalancer & other ) = delete;
+
+	/**
+	 * returns true, if a migration has been requested
+	 */
+	bool balance()
+	{
+		const auto now = YIELD::clock::now();
+		const auto period = std::chrono::duration_cast<std::chrono::nanoseconds>( now - last_run );
+		const bool first_run = last_run == YIELD::timepoint_t();
+
+		std::vector<ShardLoad> loads( shards.size() );
+
+		for( unsigned i = 0; i < shards.size(); i++ ) {
+			auto & shard = shards.get_shard( i );
+			const auto busy = shard.get_busy_time();
+
+			loads[i].id = i;
+			loads[i].busy = busy - last_busy[i];
+			loads[i].tasks = shard.get_task_count();
+
+			last_busy[i] = busy;
+		}
+
+		last_run = now;
+
+		if( first_run ) {
+			return false;
+		}
+
+		unsigned from = 0;
+		unsigned to = 0;
+		double utilization = 0;
+
+		if( !policy.plan( loads, period, from, to, utilization ) || from == to ) {
+			return false;
+		}
+
+		return shards.get_shard( from ).request_migration( shards.get_shard( to ), utilization, policy );
+	}
+
+	template<class Generator> Generator task( std::chrono::nanoseconds period )
+	{
+		while( true ) {
+			co_yield YIELD( period );
+			balance();
+		}
+	}
+};
+
+} // namespace CoScheduler
+
+#endif /* SRC_COSCHEDULER_COBALANCER_HPP_ */
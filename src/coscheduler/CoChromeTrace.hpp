@@ -0,0 +1,297 @@
+/**
+ * Export of task runs in the Chrome Trace Event format
+ * @author Copyright (c) 2024 Martin Oberzalek
+ */
+#pragma once
+#ifndef SRC_COSCHEDULER_COCHROMETRACE_HPP_
+#define SRC_COSCHEDULER_COCHROMETRACE_HPP_
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "CoScheduler.hpp"
+
+namespace CoScheduler {
+
+/**
+ * Records each resume of a task into a ring and writes them as
+ * Chrome Trace Event JSON, which can be loaded into Perfetto
+ * (ui.perfetto.dev) or chrome://tracing.
+ *
+ *   CoScheduler::ChromeTrace trace( "main scheduler" );
+ *   sch.set_tracer( &trace );
+ *   trace.set_task_name( &task, "modbus" );
+ *   ...
+ *   sch.infinite_schedule();
+ *   trace.write_json( "trace.json" );
+ *
+ * Each task gets its own track, a slice per resume, with the wakeup
+ * reason, the object it waited for and what it waits for after the slice.
+ *
+ * Recording only copies the TaskRun into the ring, names are looked up,
+ * when the JSON is written. If the ring is full, the oldest runs are
+ * overwritten, so the trace can stay enabled for a long time.
+ * Writing the JSON has to be done by the scheduler thread,
+ * or after the scheduler has stopped.
+ */
+class ChromeTrace : public TaskTracer
+{
+	const std::string name;
+	const int pid;
+
+	std::vector<TaskRun> runs;
+	const std::uint64_t mask;
+	std::uint64_t written = 0;
+
+	std::unordered_map<const void*,std::string> task_names;
+	std::unordered_map<const WaitForBase*,std::string> object_names;
+
+public:
+	/**
+	 * capacity is rounded up to a power of two,
+	 * pid tells the schedulers apart, if multiple traces are merged
+	 */
+	ChromeTrace( std::string name_ = "scheduler",
+				 std::size_t capacity = 256 * 1024,
+				 int pid_ = 1 )
+	: name( std::move( name_ ) ),
+	  pid( pid_ ),
+	  runs( round_up( capacity ) ),
+	  mask( runs.size() - 1 )
+	{}
+
+	ChromeTrace( const ChromeTrace & other ) = delete;
+	ChromeTrace & operator=( const ChromeTrace & other ) = delete;
+
+	/**
+	 * Timestamps are relative to this, the same for all traces
+	 * of the process, so the traces of multiple schedulers line up.
+	 */
+	static inline const std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+
+	void task_ran( const TaskRun & run ) override {
+		runs[written++ & mask] = run;
+	}
+
+	/**
+	 * task is the address of the generator, passed to the scheduler.
+	 * Unnamed tasks are numbered.
+	 */
+	void set_task_name( const void *task, std::string task_name ) {
+		task_names[task] = std::move( task_name );
+	}
+
+	void set_object_name( const WaitForBase & object, std::string object_name ) {
+		object_names[&object] = std::move( object_name );
+	}
+
+	std::size_t size() const {
+		return written < runs.size() ? written : runs.size();
+	}
+
+	// runs, that have been overwritten
+	std::uint64_t get_dropped() const {
+		return written - size();
+	}
+
+	void clear() {
+		written = 0;
+	}
+
+	void write_json( std::ostream & out ) const {
+		write_json( out, { this } );
+	}
+
+	/**
+	 * throws std::runtime_error, if the file can't be written
+	 */
+	void write_json( const std::string & file_name ) const
+	{
+		// ofstream does not report, why it failed
+		std::ofstream out( file_name );
+
+		if( !out ) {
+			throw std::runtime_error( "cannot open " + file_name );
+		}
+
+		write_json( out );
+		out.close();
+
+		if( !out ) {
+			throw std::runtime_error( "cannot write " + file_name );
+		}
+	}
+
+	/**
+	 * one file with the traces of multiple schedulers, eg. of a ShardGroup
+	 */
+	static void write_json( std::ostream & out, const std::vector<const ChromeTrace*> & traces )
+	{
+		bool first = true;
+
+		out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+
+		for( const ChromeTrace *trace : traces ) {
+			trace->write_events( out, first );
+		}
+
+		out << "\n]}\n";
+	}
+
+private:
+	static std::size_t round_up( std::size_t capacity )
+	{
+		std::size_t size = 1;
+
+		while( size < capacity ) {
+			size <<= 1;
+		}
+
+		return size;
+	}
+
+	void write_events( std::ostream & out, bool & first ) const
+	{
+		// tasks get a new track, when they are finished,
+		// their address may be reused by the next task
+		std::unordered_map<const void*,unsigned> tracks;
+		unsigned track_count = 0;
+
+		separator( out, first );
+		out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << pid
+			<< ",\"args\":{\"name\":\"" << escape( name ) << "\"}}";
+
+		if( get_dropped() ) {
+			separator( out, first );
+			out << "{\"name\":\"dropped runs\",\"ph\":\"i\",\"s\":\"p\",\"pid\":" << pid
+				<< ",\"tid\":0,\"ts\":0,\"args\":{\"count\":" << get_dropped() << "}}";
+		}
+
+		for( std::uint64_t i = written - size(); i < written; i++ ) {
+
+			const TaskRun & run = runs[i & mask];
+			auto it = tracks.find( run.task );
+
+			if( it == tracks.end() ) {
+				it = tracks.emplace( run.task, ++track_count ).first;
+
+				separator( out, first );
+				out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid
+					<< ",\"tid\":" << it->second
+					<< ",\"args\":{\"name\":\"" << escape( task_name( run.task, it->second ) ) << "\"}}";
+			}
+
+			separator( out, first );
+			out << "{\"name\":\"" << escape( task_name( run.task, it->second ) )
+				<< "\",\"cat\":\"task\",\"ph\":\"X\",\"pid\":" << pid
+				<< ",\"tid\":" << it->second
+				<< ",\"ts\":" << micros( run.start - origin )
+				<< ",\"dur\":" << micros( run.end - run.start )
+				<< ",\"args\":{\"wakeup\":\"" << reason( run.wakeup_reason ) << "\"";
+
+			if( run.waited_for ) {
+				out << ",\"waited_for\":\"" << escape( object_name( run.waited_for ) ) << "\"";
+			}
+
+			if( run.finished ) {
+				out << ",\"next\":\"finished\"}}";
+				tracks.erase( it );
+				continue;
+			}
+
+			if( run.waits_for ) {
+				out << ",\"next\":\"" << escape( object_name( run.waits_for ) ) << "\"}}";
+			} else {
+				out << ",\"next_run_in_us\":" << micros( run.next_run_in ) << "}}";
+			}
+		}
+	}
+
+	std::string task_name( const void *task, unsigned track ) const
+	{
+		auto it = task_names.find( task );
+
+		if( it != task_names.end() ) {
+			return it->second;
+		}
+
+		return "task " + std::to_string( track );
+	}
+
+	std::string object_name( const WaitForBase *object ) const
+	{
+		auto it = object_names.find( object );
+
+		if( it != object_names.end() ) {
+			return it->second;
+		}
+
+		char buffer[32];
+		std::snprintf( buffer, sizeof(buffer), "%p", static_cast<const void*>( object ) );
+		return buffer;
+	}
+
+	static const char * reason( YIELD::WakeupReason wakeup_reason )
+	{
+		switch( wakeup_reason )
+		{
+		case YIELD::WakeupReason::TIME:      return "time";
+		case YIELD::WakeupReason::OBJECT:    return "object";
+		case YIELD::WakeupReason::TIMEOUT:   return "timeout";
+		case YIELD::WakeupReason::CANCELLED: return "cancelled";
+		}
+
+		return "unknown";
+	}
+
+	// the trace format uses microseconds
+	static std::string micros( std::chrono::nanoseconds duration )
+	{
+		char buffer[32];
+		std::snprintf( buffer, sizeof(buffer), "%.3f", static_cast<double>( duration.count() ) / 1000.0 );
+		return buffer;
+	}
+
+	static void separator( std::ostream & out, bool & first )
+	{
+		out << ( first ? "\n" : ",\n" );
+		first = false;
+	}
+
+	static std::string escape( const std::string & s )
+	{
+		std::string escaped;
+		escaped.reserve( s.size() );
+
+		for( char c : s ) {
+			switch( c )
+			{
+			case '"':  escaped += "\\\""; break;
+			case '\\': escaped += "\\\\"; break;
+			case '\n': escaped += "\\n"; break;
+			case '\t': escaped += "\\t"; break;
+			default:
+				if( static_cast<unsigned char>( c ) < 0x20 ) {
+					char buffer[8];
+					std::snprintf( buffer, sizeof(buffer), "\\u%04x", static_cast<unsigned>( c ) );
+					escaped += buffer;
+				} else {
+					escaped += c;
+				}
+			}
+		}
+
+		return escaped;
+	}
+};
+
+} // namespace CoScheduler
+
+#endif /* SRC_COSCHEDULER_COCHROMETRACE_HPP_ */
@@ -0,0 +1,263 @@
+/**
+ * Recycling of coroutine frames
+ * @author Copyright (c) 2024 Martin Oberzalek
+ */
+#pragma once
+#ifndef SRC_COSCHEDULER_COFRAMEPOOL_HPP_
+#define SRC_COSCHEDULER_COFRAMEPOOL_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <new>
+
+namespace CoScheduler {
+
+/**
+ * Bump allocator for the frames of a group of coroutines with a bounded
+ * lifetime, see TaskScope. Freeing single frames does nothing, all the
+ * memory is released at once, when the arena is destroyed.
+ *
+ * Frames are allocated from the arena, while a FrameArenaScope is active.
+ */
+class FrameArena
+{
+	struct alignas(std::max_align_t) Chunk
+	{
+		Chunk *next;
+		std::size_t size;
+		std::size_t used;
+	};
+
+	const std::size_t chunk_size;
+	Chunk *chunks = nullptr;
+
+public:
+	FrameArena( std::size_t chunk_size_ = 16 * 1024 )
+	: chunk_size( chunk_size_ )
+	{}
+
+	~FrameArena()
+	{
+		while( chunks ) {
+			Chunk *chunk = chunks;
+			chunks = chunk->next;
+			::operator delete( chunk );
+		}
+	}
+
+	FrameArena( const FrameArena & other ) = delete;
+	FrameArena & operator=( const FrameArena & other ) = delete;
+
+	void * allocate( std::size_t size )
+	{
+		size = align( size );
+
+		if( !chunks || chunks->used + size > chunks->size ) {
+			const std::size_t data_size = std::max( chunk_size, size );
+			Chunk *chunk = static_cast<Chunk*>( ::operator new( sizeof(Chunk) + data_size ) );
+			chunk->next = chunks;
+			chunk->size = data_size;
+			chunk->used = 0;
+			chunks = chunk;
+		}
+
+		void *ptr = reinterpret_cast<unsigned char*>( chunks + 1 ) + chunks->used;
+		chunks->used += size;
+
+		return ptr;
+	}
+
+	/**
+	 * Makes all the memory available again, the newest chunk is kept.
+	 * Only allowed, when nothing allocated from the arena is alive anymore.
+	 */
+	void reset()
+	{
+		if( !chunks ) {
+			return;
+		}
+
+		while( chunks->next ) {
+			Chunk *chunk = chunks->next;
+			chunks->next = chunk->next;
+			::operator delete( chunk );
+		}
+
+		chunks->used = 0;
+	}
+
+private:
+	static constexpr std::size_t align( std::size_t size ) {
+		return ( size + alignof(std::max_align_t) - 1 ) & ~( alignof(std::max_align_t) - 1 );
+	}
+};
+
+/**
+ * Free lists for coroutine frames, one set per thread, so no locking
+ * is required. The sizes are rounded up to multiples of GRANULARITY,
+ * each size class keeps up to MAX_CACHED free blocks. Larger blocks
+ * are allocated from the heap directly.
+ *
+ * A frame may be freed by an other thread than the one, that
+ * allocated it (eg. after a task migrated to an other shard),
+ * the block is cached by the freeing thread then.
+ *
+ * Each frame starts with a small header, which tells, if the
+ * frame belongs to an arena, so it can be freed by any thread.
+ */
+class FramePool
+{
+	friend class FrameArenaScope;
+
+	struct alignas(std::max_align_t) FrameHeader
+	{
+		FrameArena *arena;
+	};
+
+	static constexpr std::size_t GRANULARITY = 64;
+	static constexpr std::size_t MAX_SIZE = 4096;
+	static constexpr std::size_t CLASSES = MAX_SIZE / GRANULARITY;
+	static constexpr std::size_t MAX_CACHED = 64;
+
+	struct FreeBlock
+	{
+		FreeBlock *next;
+	};
+
+	FreeBlock *free_lists[CLASSES] = {};
+	std::size_t cached[CLASSES] = {};
+
+	// trivially destructible, so it can be checked after the pool has been destroyed
+	static inline thread_local bool destroyed = false;
+	static inline thread_local FrameArena *current_arena = nullptr;
+
+public:
+	FramePool() = default;
+
+	~FramePool()
+	{
+		for( std::size_t i = 0; i < CLASSES; i++ ) {
+			while( free_lists[i] ) {
+				FreeBlock *block = free_lists[i];
+				free_lists[i] = block->next;
+				::operator delete( block );
+			}
+		}
+
+		destroyed = true;
+	}
+
+	FramePool( const FramePool & other ) = delete;
+	FramePool & operator=( const FramePool & other ) = delete;
+
+	static void * allocate_frame( std::size_t size )
+	{
+		const std::size_t total = size + sizeof(FrameHeader);
+		FrameHeader *header = nullptr;
+
+		if( current_arena ) {
+			header = static_cast<FrameHeader*>( current_arena->allocate( total ) );
+		} else if( destroyed ) {
+			header = static_cast<FrameHeader*>( ::operator new( total ) );
+		} else {
+			header = static_cast<FrameHeader*>( thread_instance().allocate( total ) );
+		}
+
+		header->arena = current_arena;
+
+		return header + 1;
+	}
+
+	static void deallocate_frame( void *ptr, std::size_t size ) noexcept
+	{
+		FrameHeader *header = static_cast<FrameHeader*>( ptr ) - 1;
+
+		if( header->arena ) {
+			// released together with the arena
+			return;
+		}
+
+		if( destroyed ) {
+			::operator delete( header );
+			return;
+		}
+
+		thread_instance().deallocate( header, size + sizeof(FrameHeader) );
+	}
+
+	void * allocate( std::size_t size )
+	{
+		if( size == 0 || size > MAX_SIZE ) {
+			return ::operator new( size );
+		}
+
+		const std::size_t idx = size_class( size );
+
+		if( FreeBlock *block = free_lists[idx] ) {
+			free_lists[idx] = block->next;
+			cached[idx]--;
+			return block;
+		}
+
+		return ::operator new( ( idx + 1 ) * GRANULARITY );
+	}
+
+	void deallocate( void *ptr, std::size_t size ) noexcept
+	{
+		if( size == 0 || size > MAX_SIZE ) {
+			::operator delete( ptr );
+			return;
+		}
+
+		const std::size_t idx = size_class( size );
+
+		if( cached[idx] >= MAX_CACHED ) {
+			::operator delete( ptr );
+			return;
+		}
+
+		FreeBlock *block = static_cast<FreeBlock*>( ptr );
+		block->next = free_lists[idx];
+		free_lists[idx] = block;
+		cached[idx]++;
+	}
+
+private:
+	static FramePool & thread_instance()
+	{
+		thread_local FramePool pool;
+		return pool;
+	}
+
+	static constexpr std::size_t size_class( std::size_t size ) {
+		return ( size - 1 ) / GRANULARITY;
+	}
+};
+
+/**
+ * Coroutine frames, created while this object exists,
+ * are allocated from the arena.
+ */
+class FrameArenaScope
+{
+	FrameArena *previous;
+
+public:
+	FrameArenaScope( FrameArena & arena )
+	: previous( FramePool::current_arena )
+	{
+		FramePool::current_arena = &arena;
+	}
+
+	~FrameArenaScope()
+	{
+		FramePool::current_arena = previous;
+	}
+
+	FrameArenaScope( const FrameArenaScope & other ) = delete;
+	FrameArenaScope & operator=( const FrameArenaScope & other ) = delete;
+};
+
+} // namespace CoScheduler
+
+#endif /* SRC_COSCHEDULER_COFRAMEPOOL_HPP_ */
@@ -8,11 +8,74 @@
 
 #include <coroutine>
 #include <exception>
+#include <system_error>
+#include <utility>
+#include "CoFramePool.hpp"
 
 namespace CoScheduler {
 
+/**
+ * How a coroutine reports errors to the caller of the generator.
+ * Selected in the Conf via the yield_type:
+ *
+ *   using yield_type = CoScheduler::CoGenerator<CoScheduler::YIELD,CoScheduler::ErrorModel::ERROR_CODES>;
+ */
+enum class ErrorModel
+{
+	// exceptions thrown by the coroutine are rethrown by the generator
+	EXCEPTIONS,
+
+	// the coroutine fails with co_yield std::make_error_code( ... ),
+	// the generator is finished then, see CoGenerator::error().
+	// Works with -fno-exceptions.
+	ERROR_CODES,
+
+	// an exception thrown by the coroutine terminates the program
+	TERMINATE
+};
+
+#if __cpp_exceptions
+inline constexpr ErrorModel DEFAULT_ERROR_MODEL = ErrorModel::EXCEPTIONS;
+#else
+inline constexpr ErrorModel DEFAULT_ERROR_MODEL = ErrorModel::ERROR_CODES;
+#endif
+
+/**
+ * error state of the promise, depending on the ErrorModel,
+ * so only ErrorModel::EXCEPTIONS requires std::exception_ptr
+ */
+template<ErrorModel model> struct PromiseErrors;
+
+#if __cpp_exceptions
+template<> struct PromiseErrors<ErrorModel::EXCEPTIONS>
+{
+	std::exception_ptr exception_;
+
+	void unhandled_exception() {
+		exception_ = std::current_exception();
+	}
+};
+#endif
+
+template<> struct PromiseErrors<ErrorModel::ERROR_CODES>
+{
+	std::error_code error_;
+
+	// only possible, if exceptions are enabled
+	void unhandled_exception() {
+		error_ = std::make_error_code( std::errc::state_not_recoverable );
+	}
+};
+
+template<> struct PromiseErrors<ErrorModel::TERMINATE>
+{
+	void unhandled_exception() {
+		std::terminate();
+	}
+};
+
 // this is copy & paste from https://en.cppreference.com/w/cpp/language/coroutines
-template<typename T>
+template<typename T, ErrorModel model = DEFAULT_ERROR_MODEL>
 struct CoGenerator
 {
     // The class name 'Generator' is our choice and it is not required for coroutine
@@ -23,10 +86,38 @@ struct CoGenerator
     struct promise_type;
     using handle_type = std::coroutine_handle<promise_type>;
 
-    struct promise_type // required
+#if !__cpp_exceptions
+    static_assert( model != ErrorModel::EXCEPTIONS, "ErrorModel::EXCEPTIONS requires exceptions to be enabled" );
+#endif
+
+    struct promise_type : public PromiseErrors<model> // required
     {
         T value_;
-        std::exception_ptr exception_;
+
+        /*
+         * co_yield returns the yielded value, after it has
+         * been updated by the scheduler. So the coroutine
+         * can find out why it has been resumed.
+         */
+        struct yield_awaiter
+        {
+            promise_type & promise;
+
+            bool await_ready() const noexcept { return false; }
+            void await_suspend( std::coroutine_handle<> ) const noexcept {}
+            const T & await_resume() const noexcept { return promise.value_; }
+        };
+
+        // frames are recycled, see FramePool
+        static void* operator new( std::size_t size )
+        {
+            return FramePool::allocate_frame( size );
+        }
+
+        static void operator delete( void *ptr, std::size_t size ) noexcept
+        {
+            FramePool::deallocate_frame( ptr, size );
+        }
 
         CoGenerator get_return_object()
         {
@@ -34,13 +125,18 @@ struct CoGenerator
         }
         std::suspend_always initial_suspend() { return {}; }
         std::suspend_always final_suspend() noexcept { return {}; }
-        void unhandled_exception() { exception_ = std::current_exception(); } // saving
-                                                                              // exception
 
         template<std::convertible_to<T> From> // C++20 concept
-        std::suspend_always yield_value(From&& from)
+        yield_awaiter yield_value(From&& from)
         {
             value_ = std::forward<From>(from); // caching the result in promise
+            return { *this };
+        }
+
+        // the coroutine failed, it is never resumed again
+        std::suspend_always yield_value( std::error_code error ) requires( model == ErrorModel::ERROR_CODES )
+        {
+            this->error_ = error;
             return {};
         }
         void return_void() {}
@@ -49,7 +145,21 @@ struct CoGenerator
     handle_type h_;
 
     CoGenerator(handle_type h) : h_(h) {}
-    ~CoGenerator() { h_.destroy(); }
+    CoGenerator(CoGenerator&& other) noexcept : h_(std::exchange(other.h_, nullptr)), error_(other.error_), full_(other.full_) {}
+    CoGenerator(const CoGenerator&) = delete;
+    CoGenerator& operator=(const CoGenerator&) = delete;
+    ~CoGenerator() { reset(); }
+
+    // destroys the coroutine before the generator goes out of scope
+    void reset()
+    {
+        if (h_)
+        {
+            h_.destroy();
+            h_ = nullptr;
+        }
+    }
+
     explicit operator bool()
     {
         fill(); // The only way to reliably find out whether or not we finished coroutine,
@@ -58,7 +168,27 @@ struct CoGenerator
                 // coroutine until the next co_yield point (or let it fall off end).
                 // Then we store/cache result in promise to allow getter (operator() below
                 // to grab it without executing coroutine).
-        return !h_.done();
+        return !finished();
+    }
+
+    // done, or failed with an error code
+    bool finished()
+    {
+        if constexpr( model == ErrorModel::ERROR_CODES ) {
+            if( error_ ) {
+                return true;
+            }
+        }
+
+        return h_.done();
+    }
+
+    /*
+     * the error code the coroutine failed with (ErrorModel::ERROR_CODES).
+     * Stays valid after the scheduler has destroyed the coroutine.
+     */
+    std::error_code error() const {
+        return error_;
     }
 
 #if 0
@@ -86,6 +216,7 @@ struct CoGenerator
     }
 
 private:
+    std::error_code error_;
     bool full_ = false;
 
     void fill()
@@ -93,9 +224,16 @@ private:
         if (!full_)
         {
             h_();
-            if (h_.promise().exception_)
-                std::rethrow_exception(h_.promise().exception_);
-            // propagate coroutine exception in called context
+
+            if constexpr( model == ErrorModel::EXCEPTIONS ) {
+#if __cpp_exceptions
+                if (h_.promise().exception_)
+                    std::rethrow_exception(h_.promise().exception_);
+                // propagate coroutine exception in called context
+#endif
+            } else if constexpr( model == ErrorModel::ERROR_CODES ) {
+                error_ = h_.promise().error_;
+            }
 
             full_ = true;
         }
@@ -0,0 +1,87 @@
+/**
+ * Interruptible idle function for the scheduler
+ * @author Copyright (c) 2024 Martin Oberzalek
+ */
+#pragma once
+#ifndef SRC_COSCHEDULER_COIDLEWAITER_HPP_
+#define SRC_COSCHEDULER_COIDLEWAITER_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+
+namespace CoScheduler {
+
+/**
+ * Sleeps until the timeout is reached, or someone calls notify().
+ *
+ * notify() can be called from any thread. Multiple notifications,
+ * while the scheduler is still running, are collapsed into one, so
+ * only the first one has to take the lock.
+ *
+ * On a microcontroller you may replace this class by one,
+ * that waits for an interrupt in wait_for().
+ *
+ * An other implementation is IoUring, which also does
+ * the asynchronous file io.
+ */
+class IdleWaiter
+{
+	std::mutex              m;
+	std::condition_variable cond;
+	std::atomic<bool>       notified = false;
+
+public:
+	void wait_for( std::chrono::nanoseconds timeout )
+	{
+		{
+			std::unique_lock<std::mutex> lock( m );
+			cond.wait_for( lock, timeout, [this]() {
+				return notified.load( std::memory_order_acquire );
+			});
+		}
+
+		notified.store( false, std::memory_order_release );
+	}
+
+	/**
+	 * called at the start of each schedule() run,
+	 * nothing to do here
+	 */
+	void poll()
+	{
+	}
+
+	void notify()
+	{
+		if( notified.exchange( true, std::memory_order_acq_rel ) ) {
+			// already notified
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock( m );
+		cond.notify_one();
+	}
+};
+
+/**
+ * Default for configurations without Conf::IDLE_WAITER,
+ * idle() can't be interrupted then.
+ */
+class NoIdleWaiter
+{
+public:
+	void wait_for( std::chrono::nanoseconds ) {
+	}
+
+	void poll() {
+	}
+
+	void notify() {
+	}
+};
+
+} // namespace CoScheduler
+
+#endif /* SRC_COSCHEDULER_COIDLEWAITER_HPP_ */
@@ -0,0 +1,158 @@
+/**
+ * Lock free inbox, for handing over objects to the scheduler thread
+ * @author Copyright (c) 2024 Martin Oberzalek
+ */
+#pragma once
+#ifndef SRC_COSCHEDULER_COINBOX_HPP_
+#define SRC_COSCHEDULER_COINBOX_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace CoScheduler {
+
+/**
+ * Bounded multi producer, single consumer queue.
+ * Every thread (or interrupt) may push(), only the scheduler thread pops().
+ * No heap usage, so it can be used on microcontrollers too.
+ *
+ * Each cell carries a sequence number, which tells the producers
+ * and the consumer whether the cell is free or filled.
+ */
+template<class T, std::size_t N> class Inbox
+{
+	static_assert( N >= 2 && ( N & ( N - 1 ) ) == 0, "N has to be a power of two" );
+
+	struct Cell
+	{
+		std::atomic<std::size_t> sequence;
+		T data;
+	};
+
+	Cell cells[N];
+	alignas(64) std::atomic<std::size_t> enqueue_pos;
+	alignas(64) std::size_t dequeue_pos;
+
+public:
+	Inbox()
+	: enqueue_pos( 0 ),
+	  dequeue_pos( 0 )
+	{
+		for( std::size_t i = 0; i < N; i++ ) {
+			cells[i].sequence.store( i, std::memory_order_relaxed );
+		}
+	}
+
+	Inbox( const Inbox & other ) = delete;
+	Inbox & operator=( const Inbox & other ) = delete;
+
+	/**
+	 * can be called from any thread
+	 * returns false if the inbox is full
+	 */
+	bool push( const T & data )
+	{
+		std::size_t pos = enqueue_pos.load( std::memory_order_relaxed );
+
+		while( true ) {
+			Cell & cell = cells[pos & ( N - 1 )];
+			const std::size_t seq = cell.sequence.load( std::memory_order_acquire );
+			const std::intptr_t diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+
+			if( diff == 0 ) {
+				if( enqueue_pos.compare_exchange_weak( pos, pos + 1, std::memory_order_relaxed ) ) {
+					cell.data = data;
+					cell.sequence.store( pos + 1, std::memory_order_release );
+					return true;
+				}
+			} else if( diff < 0 ) {
+				// full
+				return false;
+			} else {
+				pos = enqueue_pos.load( std::memory_order_relaxed );
+			}
+		}
+	}
+
+	/**
+	 * only the consumer thread is allowed to call this
+	 * returns false if the inbox is empty
+	 */
+	bool pop( T & data )
+	{
+		Cell & cell = cells[dequeue_pos & ( N - 1 )];
+		const std::size_t seq = cell.sequence.load( std::memory_order_acquire );
+
+		if( seq != dequeue_pos + 1 ) {
+			return false;
+		}
+
+		data = cell.data;
+		cell.sequence.store( dequeue_pos + N, std::memory_order_release );
+		dequeue_pos++;
+
+		return true;
+	}
+};
+
+/**
+ * Unbounded inbox, the default for configurations without
+ * Conf::CONTAINER_REMOTE_TASKS. push() takes a lock and may allocate,
+ * pop() only locks, when something has been pushed.
+ */
+template<class T> class VectorInbox
+{
+	std::mutex m;
+	std::vector<T> pushed;
+	std::atomic<bool> filled = false;
+
+	// only used by the consumer
+	std::vector<T> taken;
+	std::size_t next = 0;
+
+public:
+	VectorInbox() = default;
+
+	VectorInbox( const VectorInbox & other ) = delete;
+	VectorInbox & operator=( const VectorInbox & other ) = delete;
+
+	bool push( const T & data )
+	{
+		std::lock_guard<std::mutex> lock( m );
+		pushed.push_back( data );
+		filled.store( true, std::memory_order_release );
+		return true;
+	}
+
+	bool pop( T & data )
+	{
+		if( next == taken.size() ) {
+			if( !filled.load( std::memory_order_acquire ) ) {
+				return false;
+			}
+
+			taken.clear();
+			next = 0;
+
+			{
+				std::lock_guard<std::mutex> lock( m );
+				taken.swap( pushed );
+				filled.store( false, std::memory_order_relaxed );
+			}
+
+			if( taken.empty() ) {
+				return false;
+			}
+		}
+
+		data = taken[next++];
+		return true;
+	}
+};
+
+} // namespace CoScheduler
+
+#endif /* SRC_COSCHEDULER_COINBOX_HPP_ */
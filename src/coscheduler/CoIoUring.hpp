@@ -0,0 +1,571 @@
+/**
+ * Asynchronous file io via io_uring (linux only)
+ * @author Copyright (c) 2024 Martin Oberzalek
+ */
+#pragma once
+#ifndef SRC_COSCHEDULER_COIOURING_HPP_
+#define SRC_COSCHEDULER_COIOURING_HPP_
+
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <cstdint>
+#include <vector>
+#include <system_error>
+#include "CoScheduler.hpp"
+
+namespace CoScheduler {
+
+class IoUring;
+
+/**
+ * One read or write operation.
+ * Yield on it, to wait until the kernel has finished it.
+ *
+ *   char buffer[1024];
+ *   auto read = CoScheduler::async_read( sch.get_idle_waiter(), fd, buffer, sizeof(buffer), 0 );
+ *   co_yield YIELD( read );
+ *
+ *   if( read.result() < 0 ) {
+ *     // -errno
+ *   }
+ *
+ * The buffer has to stay valid until the operation is finished.
+ * If the request is destroyed earlier, the operation is canceled and
+ * the destructor waits, until the kernel has reported the completion,
+ * so the buffer is not touched anymore afterwards.
+ */
+class IoRequest : public WaitForBase
+{
+	friend class IoUring;
+
+	IoUring * ring = nullptr;
+	unsigned  slot = 0;
+	bool      completed = false;
+	int       res = 0;
+
+public:
+	inline IoRequest( IoUring & ring, unsigned char opcode, int fd, void *buffer, unsigned len, off_t offset );
+	inline ~IoRequest();
+
+	IoRequest( const IoRequest & other ) = delete;
+	IoRequest & operator=( const IoRequest & other ) = delete;
+
+	bool condition_reached() const override {
+		return completed;
+	}
+
+	/**
+	 * number of transferred bytes, or -errno
+	 */
+	int result() const {
+		return res;
+	}
+
+private:
+	void complete( int res_ ) {
+		res = res_;
+		completed = true;
+		ring = nullptr;
+	}
+};
+
+/**
+ * io_uring instance, that can be used as Conf::IDLE_WAITER
+ *
+ * All requests created during one schedule() run are submitted
+ * with one system call at the start of the next run (poll()),
+ * or when the scheduler goes idle (wait_for()).
+ * Completions are reaped at the same places, so the scheduler
+ * thread never blocks in a read() or write() call.
+ *
+ * An eventfd is kept armed in the ring, so notify() from other
+ * threads interrupts the waiting in wait_for().
+ *
+ * Requires linux >= 5.11
+ */
+class IoUring
+{
+	friend class IoRequest;
+
+	static constexpr std::uint64_t WAKEUP_TAG = ~std::uint64_t(0);
+	static constexpr std::uint64_t IGNORE_TAG = ~std::uint64_t(0) - 1;
+
+	int fd = -1;
+	int wakeup_fd = -1;
+
+	void     *sq_ptr = nullptr;
+	std::size_t sq_size = 0;
+	void     *cq_ptr = nullptr;
+	std::size_t cq_size = 0;
+	io_uring_sqe *sqes = nullptr;
+	std::size_t sqes_size = 0;
+
+	unsigned *sq_head = nullptr;
+	unsigned *sq_tail = nullptr;
+	unsigned *sq_mask = nullptr;
+	unsigned *sq_array = nullptr;
+	unsigned  sq_entries = 0;
+
+	unsigned *cq_head = nullptr;
+	unsigned *cq_tail = nullptr;
+	unsigned *cq_mask = nullptr;
+	io_uring_cqe *cqes = nullptr;
+
+	unsigned to_submit = 0;
+
+	/*
+	 * user_data of an operation is an index into this table.
+	 * A slot is free again, when its completion arrived.
+	 */
+	struct Slot
+	{
+		IoRequest *request = nullptr;
+		bool in_flight = false;
+		bool cancel_queued = false;
+	};
+
+	std::vector<Slot>     slots;
+	std::vector<unsigned> free_slots;
+
+	std::atomic<bool> notified = false;
+	std::uint64_t     wakeup_buffer = 0;
+	bool              wakeup_armed = false;
+	bool              closing = false;
+
+public:
+	IoUring( unsigned entries = 256 )
+	{
+		io_uring_params params{};
+
+		fd = static_cast<int>( syscall( __NR_io_uring_setup, entries, &params ) );
+
+		if( fd < 0 ) {
+			throw std::system_error( errno, std::generic_category(), "io_uring_setup" );
+		}
+
+		try {
+			setup( params );
+		} catch( ... ) {
+			unmap();
+			throw;
+		}
+	}
+
+	/**
+	 * Requests, that are still in flight, are canceled. The destructor
+	 * waits for their completion, before the ring is closed, so the kernel
+	 * does not touch any buffer afterwards. Existing IoRequest objects
+	 * are completed with -ECANCELED.
+	 */
+	~IoUring()
+	{
+		cancel_all();
+		unmap();
+	}
+
+	IoUring( const IoUring & other ) = delete;
+	IoUring & operator=( const IoUring & other ) = delete;
+
+	/**
+	 * submits all pending requests and reaps completions, without waiting
+	 */
+	void poll()
+	{
+		if( to_submit ) {
+			enter( 0, 0, nullptr );
+		}
+
+		reap();
+	}
+
+	void wait_for( std::chrono::nanoseconds timeout )
+	{
+		if( !notified.load( std::memory_order_acquire ) ) {
+			__kernel_timespec ts{};
+			ts.tv_sec  = std::chrono::duration_cast<std::chrono::seconds>( timeout ).count();
+			ts.tv_nsec = ( timeout - std::chrono::seconds( ts.tv_sec ) ).count();
+
+			io_uring_getevents_arg arg{};
+			arg.ts = reinterpret_cast<std::uint64_t>( &ts );
+
+			enter( 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg );
+		}
+
+		reap();
+
+		notified.store( false, std::memory_order_release );
+	}
+
+	void notify()
+	{
+		if( notified.exchange( true, std::memory_order_acq_rel ) ) {
+			return;
+		}
+
+		const std::uint64_t one = 1;
+		[[maybe_unused]] auto ret = write( wakeup_fd, &one, sizeof(one) );
+	}
+
+private:
+	void setup( const io_uring_params & params )
+	{
+		if( !( params.features & IORING_FEAT_EXT_ARG ) ) {
+			throw std::system_error( ENOSYS, std::generic_category(), "io_uring without IORING_FEAT_EXT_ARG" );
+		}
+
+		sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+		cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+		if( params.features & IORING_FEAT_SINGLE_MMAP ) {
+			sq_size = std::max( sq_size, cq_size );
+			cq_size = 0;
+		}
+
+		sq_ptr = map( sq_size, IORING_OFF_SQ_RING );
+
+		if( cq_size ) {
+			cq_ptr = map( cq_size, IORING_OFF_CQ_RING );
+		} else {
+			cq_ptr = sq_ptr;
+		}
+
+		sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+		sqes = static_cast<io_uring_sqe*>( map( sqes_size, IORING_OFF_SQES ) );
+
+		char *sq = static_cast<char*>(sq_ptr);
+		sq_head  = reinterpret_cast<unsigned*>( sq + params.sq_off.head );
+		sq_tail  = reinterpret_cast<unsigned*>( sq + params.sq_off.tail );
+		sq_mask  = reinterpret_cast<unsigned*>( sq + params.sq_off.ring_mask );
+		sq_array = reinterpret_cast<unsigned*>( sq + params.sq_off.array );
+		sq_entries = params.sq_entries;
+
+		char *cq = static_cast<char*>(cq_ptr);
+		cq_head = reinterpret_cast<unsigned*>( cq + params.cq_off.head );
+		cq_tail = reinterpret_cast<unsigned*>( cq + params.cq_off.tail );
+		cq_mask = reinterpret_cast<unsigned*>( cq + params.cq_off.ring_mask );
+		cqes    = reinterpret_cast<io_uring_cqe*>( cq + params.cq_off.cqes );
+
+		slots.resize( params.cq_entries );
+		free_slots.reserve( params.cq_entries );
+
+		for( unsigned i = params.cq_entries; i > 0; i-- ) {
+			free_slots.push_back( i - 1 );
+		}
+
+		wakeup_fd = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+
+		if( wakeup_fd < 0 ) {
+			throw std::system_error( errno, std::generic_category(), "eventfd" );
+		}
+
+		arm_wakeup();
+	}
+
+	/**
+	 * closes everything, that has been set up so far
+	 */
+	void unmap()
+	{
+		if( sqes ) {
+			munmap( sqes, sqes_size );
+		}
+
+		if( cq_ptr && cq_ptr != sq_ptr ) {
+			munmap( cq_ptr, cq_size );
+		}
+
+		if( sq_ptr ) {
+			munmap( sq_ptr, sq_size );
+		}
+
+		if( wakeup_fd >= 0 ) {
+			close( wakeup_fd );
+		}
+
+		if( fd >= 0 ) {
+			close( fd );
+		}
+
+		sqes = nullptr;
+		cq_ptr = nullptr;
+		sq_ptr = nullptr;
+		wakeup_fd = -1;
+		fd = -1;
+	}
+
+	void* map( std::size_t size, off_t offset )
+	{
+		void *ptr = mmap( nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset );
+
+		if( ptr == MAP_FAILED ) {
+			throw std::system_error( errno, std::generic_category(), "mmap io_uring" );
+		}
+
+		return ptr;
+	}
+
+	void enter( unsigned min_complete, unsigned flags, io_uring_getevents_arg *arg )
+	{
+		const long ret = syscall( __NR_io_uring_enter, fd, to_submit, min_complete, flags,
+								  arg, arg ? sizeof(*arg) : 0 );
+
+		if( ret > 0 ) {
+			to_submit -= std::min<unsigned>( to_submit, static_cast<unsigned>(ret) );
+		}
+		// ETIME, EINTR and EBUSY are expected here. EBUSY means the
+		// completion queue is full, reap() will free it.
+	}
+
+	/**
+	 * returns nullptr, if the submission queue is full
+	 * after submitting all pending entries
+	 */
+	io_uring_sqe* get_sqe()
+	{
+		unsigned tail = *sq_tail;
+
+		if( tail - std::atomic_ref<unsigned>( *sq_head ).load( std::memory_order_acquire ) >= sq_entries ) {
+			enter( 0, 0, nullptr );
+
+			if( tail - std::atomic_ref<unsigned>( *sq_head ).load( std::memory_order_acquire ) >= sq_entries ) {
+				return nullptr;
+			}
+		}
+
+		const unsigned idx = tail & *sq_mask;
+		io_uring_sqe *sqe = &sqes[idx];
+		*sqe = io_uring_sqe{};
+		sq_array[idx] = idx;
+
+		return sqe;
+	}
+
+	void commit_sqe()
+	{
+		std::atomic_ref<unsigned>( *sq_tail ).store( *sq_tail + 1, std::memory_order_release );
+		to_submit++;
+	}
+
+	/**
+	 * returns false, if the submission queue is full
+	 */
+	bool queue_cancel( std::uint64_t user_data )
+	{
+		io_uring_sqe *sqe = get_sqe();
+
+		if( !sqe ) {
+			return false;
+		}
+
+		sqe->opcode    = IORING_OP_ASYNC_CANCEL;
+		sqe->fd        = -1;
+		sqe->addr      = user_data;
+		sqe->user_data = IGNORE_TAG;
+
+		commit_sqe();
+
+		return true;
+	}
+
+	void arm_wakeup()
+	{
+		io_uring_sqe *sqe = get_sqe();
+
+		if( !sqe ) {
+			return;
+		}
+
+		sqe->opcode    = IORING_OP_READ;
+		sqe->fd        = wakeup_fd;
+		sqe->addr      = reinterpret_cast<std::uint64_t>( &wakeup_buffer );
+		sqe->len       = sizeof(wakeup_buffer);
+		sqe->user_data = WAKEUP_TAG;
+
+		commit_sqe();
+		wakeup_armed = true;
+	}
+
+	int submit( IoRequest & request, unsigned char opcode, int file, void *buffer, unsigned len, off_t offset )
+	{
+		if( free_slots.empty() ) {
+			return -EBUSY;
+		}
+
+		io_uring_sqe *sqe = get_sqe();
+
+		if( !sqe ) {
+			return -EBUSY;
+		}
+
+		const unsigned idx = free_slots.back();
+		free_slots.pop_back();
+
+		slots[idx].request = &request;
+		slots[idx].in_flight = true;
+		slots[idx].cancel_queued = false;
+		request.slot = idx;
+
+		sqe->opcode    = opcode;
+		sqe->fd        = file;
+		sqe->addr      = reinterpret_cast<std::uint64_t>( buffer );
+		sqe->len       = len;
+		sqe->off       = static_cast<std::uint64_t>( offset );
+		sqe->user_data = idx;
+
+		commit_sqe();
+
+		return 0;
+	}
+
+	/**
+	 * The request is going away. Cancels the operation and waits for its
+	 * completion, the kernel may write into the buffer till then.
+	 * Completions of other requests, arriving meanwhile, are reported as usual.
+	 */
+	void abandon( IoRequest & request )
+	{
+		Slot & slot = slots[request.slot];
+
+		slot.request = nullptr;
+
+		while( slot.in_flight ) {
+
+			if( !slot.cancel_queued ) {
+				slot.cancel_queued = queue_cancel( request.slot );
+			}
+
+			enter( 1, IORING_ENTER_GETEVENTS, nullptr );
+			reap();
+		}
+	}
+
+	/**
+	 * Cancels all requests and the read of the eventfd
+	 * and waits for their completion.
+	 */
+	void cancel_all()
+	{
+		if( fd < 0 ) {
+			return;
+		}
+
+		closing = true;
+
+		for( Slot & slot : slots ) {
+			if( slot.request ) {
+				slot.request->complete( -ECANCELED );
+				slot.request = nullptr;
+			}
+		}
+
+		bool wakeup_cancel_queued = false;
+
+		while( true ) {
+			bool in_flight = false;
+
+			for( unsigned idx = 0; idx < slots.size(); idx++ ) {
+				Slot & slot = slots[idx];
+
+				if( slot.in_flight ) {
+					in_flight = true;
+
+					if( !slot.cancel_queued ) {
+						slot.cancel_queued = queue_cancel( idx );
+					}
+				}
+			}
+
+			if( wakeup_armed ) {
+				in_flight = true;
+
+				if( !wakeup_cancel_queued ) {
+					wakeup_cancel_queued = queue_cancel( WAKEUP_TAG );
+				}
+			}
+
+			if( !in_flight ) {
+				return;
+			}
+
+			enter( 1, IORING_ENTER_GETEVENTS, nullptr );
+			reap();
+		}
+	}
+
+	void reap()
+	{
+		unsigned head = *cq_head;
+		const unsigned tail = std::atomic_ref<unsigned>( *cq_tail ).load( std::memory_order_acquire );
+		bool rearm = false;
+
+		for( ; head != tail; head++ ) {
+			const io_uring_cqe & cqe = cqes[head & *cq_mask];
+
+			if( cqe.user_data == WAKEUP_TAG ) {
+				wakeup_armed = false;
+				rearm = !closing;
+				continue;
+			}
+
+			if( cqe.user_data == IGNORE_TAG ) {
+				continue;
+			}
+
+			Slot & slot = slots[cqe.user_data];
+
+			if( slot.request ) {
+				slot.request->complete( cqe.res );
+			}
+
+			slot.request = nullptr;
+			slot.in_flight = false;
+			slot.cancel_queued = false;
+			free_slots.push_back( static_cast<unsigned>( cqe.user_data ) );
+		}
+
+		std::atomic_ref<unsigned>( *cq_head ).store( head, std::memory_order_release );
+
+		if( rearm ) {
+			arm_wakeup();
+		}
+	}
+};
+
+IoRequest::IoRequest( IoUring & ring_, unsigned char opcode, int fd, void *buffer, unsigned len, off_t offset )
+{
+	const int err = ring_.submit( *this, opcode, fd, buffer, len, offset );
+
+	if( err < 0 ) {
+		complete( err );
+	} else {
+		ring = &ring_;
+	}
+}
+
+IoRequest::~IoRequest()
+{
+	if( ring && !completed ) {
+		ring->abandon( *this );
+	}
+}
+
+inline IoRequest async_read( IoUring & ring, int fd, void *buffer, unsigned len, off_t offset )
+{
+	return IoRequest( ring, IORING_OP_READ, fd, buffer, len, offset );
+}
+
+inline IoRequest async_write( IoUring & ring, int fd, const void *buffer, unsigned len, off_t offset )
+{
+	return IoRequest( ring, IORING_OP_WRITE, fd, const_cast<void*>(buffer), len, offset );
+}
+
+} // namespace CoScheduler
+
+#endif /* SRC_COSCHEDULER_COIOURING_HPP_ */
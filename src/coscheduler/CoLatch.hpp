@@ -0,0 +1,129 @@
+/**
+ * Latch and barrier for joining groups of coroutines
+ * @author Copyright (c) 2024 Martin Oberzalek
+ */
+#pragma once
+#ifndef SRC_COSCHEDULER_COLATCH_HPP_
+#define SRC_COSCHEDULER_COLATCH_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include "CoScheduler.hpp"
+
+namespace CoScheduler {
+
+/**
+ * Single use countdown.
+ * All coroutines waiting on it are released within the
+ * schedule() run after the counter reached zero.
+ *
+ *   CoScheduler::latch done( 3 );
+ *
+ *   // in each worker
+ *   done.count_down();
+ *
+ *   // in the joiner
+ *   co_yield YIELD( done );
+ *
+ * count_down() can be called from an other thread or an interrupt too,
+ * call Scheduler::wakeup() afterwards in this case.
+ */
+class latch : public WaitForBase
+{
+	std::atomic<unsigned> counter;
+
+public:
+	latch( unsigned expected )
+	: counter( expected )
+	{}
+
+	latch( const latch & other ) = delete;
+	latch & operator=( const latch & other ) = delete;
+
+	/**
+	 * stops at zero, additional count downs are ignored
+	 */
+	void count_down( unsigned n = 1 ) {
+		unsigned current = counter.load( std::memory_order_relaxed );
+
+		while( current > 0 &&
+			   !counter.compare_exchange_weak( current, current - std::min( n, current ),
+											   std::memory_order_acq_rel, std::memory_order_relaxed ) ) {
+		}
+	}
+
+	bool try_wait() const {
+		return counter.load( std::memory_order_acquire ) == 0;
+	}
+
+	bool condition_reached() const override {
+		return try_wait();
+	}
+};
+
+/**
+ * Reusable barrier for a fixed number of participants.
+ *
+ * Every participant calls arrive() once per phase and waits
+ * on the returned object:
+ *
+ *   co_yield YIELD( my_barrier.arrive() );
+ *
+ * When the last participant arrives, all participants of the
+ * phase are released and the next phase starts.
+ *
+ * There are two waiter objects, one for the current phase
+ * and one for the next phase. So fast participants, that are
+ * already arriving for the next phase, are not mixed up with
+ * slow participants, that are still waiting to be resumed from
+ * the last phase.
+ *
+ * All functions have to be called from the scheduler thread.
+ */
+class barrier
+{
+	class phase_waiter : public WaitForBase
+	{
+	public:
+		bool released = false;
+
+		bool condition_reached() const override {
+			return released;
+		}
+	};
+
+	const unsigned expected;
+	unsigned pending;
+	unsigned current_phase = 0;
+	phase_waiter waiters[2];
+
+public:
+	barrier( unsigned expected_ )
+	: expected( expected_ ),
+	  pending( expected_ )
+	{}
+
+	barrier( const barrier & other ) = delete;
+	barrier & operator=( const barrier & other ) = delete;
+
+	WaitForBase & arrive() {
+		phase_waiter & waiter = waiters[current_phase & 1];
+
+		if( --pending == 0 ) {
+			pending = expected;
+			current_phase++;
+			waiters[current_phase & 1].released = false;
+			waiter.released = true;
+		}
+
+		return waiter;
+	}
+
+	unsigned phase() const {
+		return current_phase;
+	}
+};
+
+} // namespace CoScheduler
+
+#endif /* SRC_COSCHEDULER_COLATCH_HPP_ */
@@ -0,0 +1,253 @@
+/**
+ * Asynchronous debug output
+ * @author Copyright (c) 2024 Martin Oberzalek
+ */
+#pragma once
+#ifndef SRC_COSCHEDULER_COLOG_HPP_
+#define SRC_COSCHEDULER_COLOG_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <format.h>
+#include <OutDebug.h>
+#include "CoScheduler.hpp"
+#include "CoInbox.hpp"
+
+namespace CoScheduler {
+
+enum class LogOverflow
+{
+	DROP,	// the message is lost, the number of lost messages is reported later
+	BLOCK	// wait until there is space again, only allowed with a drain thread
+};
+
+/**
+ * Placeholder argument, that is replaced by the time,
+ * the message was created, formatted by the time formatter of the log.
+ */
+struct log_timestamp {};
+
+namespace LogDetail {
+
+static constexpr std::size_t MAX_STRING_LEN = 48;
+
+/**
+ * strings are copied, longer strings are truncated
+ */
+struct String
+{
+	char text[MAX_STRING_LEN];
+
+	String( std::string_view s ) {
+		const std::size_t len = std::min( s.size(), sizeof(text) - 1 );
+		std::memcpy( text, s.data(), len );
+		text[len] = '\0';
+	}
+
+	// like printf
+	String( const char *s )
+	: String( s ? std::string_view( s ) : std::string_view( "(null)" ) )
+	{}
+};
+
+template<class T, class Enable = void> struct Capture
+{
+	static_assert( std::is_arithmetic_v<T> || std::is_enum_v<T> || std::is_pointer_v<T>,
+				   "type not supported by the async log, convert it to a string first" );
+	using type = T;
+};
+
+template<class T> struct Capture<T, std::enable_if_t<std::is_convertible_v<const T&, std::string_view>>>
+{
+	using type = String;
+};
+
+template<> struct Capture<log_timestamp>
+{
+	using type = log_timestamp;
+};
+
+template<class T> using capture_t = typename Capture<std::decay_t<T>>::type;
+
+} // namespace LogDetail
+
+/**
+ * Lock free ring of log messages.
+ *
+ * The producer only copies the format string pointer, the arguments
+ * and a timestamp into the ring. Formatting via Tools::format() and
+ * writing via Tools::x_debug is done later by drain(), from a low
+ * priority drain coroutine, see drain_task(), or from a separate
+ * thread, see drain_loop().
+ *
+ * Supported arguments are numbers, pointers, strings (copied and
+ * truncated to 47 chars) and log_timestamp. The format string
+ * has to be a string literal.
+ *
+ *   CoScheduler::AsyncLog<> async_log;
+ *
+ *   CO_DEBUG( async_log, "%s: %s", __FUNCTION__, CoScheduler::log_timestamp() );
+ *
+ * Messages can be added from any thread.
+ */
+template<std::size_t RING_SIZE = 256, std::size_t ARGS_SIZE = 128> class AsyncLog
+{
+public:
+	using clock = std::chrono::system_clock;
+	using time_formatter_t = std::string (*)( clock::time_point tp );
+
+private:
+	struct Record
+	{
+		const char *file;
+		unsigned    line;
+		const char *function;
+		const char *fmt;
+		clock::time_point timestamp;
+		std::string (*render)( const Record & record, time_formatter_t time_formatter );
+		alignas(std::max_align_t) unsigned char args[ARGS_SIZE];
+	};
+
+	Inbox<Record,RING_SIZE>  ring;
+	std::atomic<std::size_t> dropped = 0;
+	const LogOverflow        overflow;
+	time_formatter_t         time_formatter;
+
+public:
+	AsyncLog( LogOverflow overflow_ = LogOverflow::DROP, time_formatter_t time_formatter_ = &default_time_formatter )
+	: overflow( overflow_ ),
+	  time_formatter( time_formatter_ )
+	{}
+
+	void set_time_formatter( time_formatter_t time_formatter_ ) {
+		time_formatter = time_formatter_;
+	}
+
+	template<class... Args>
+	void add( const char *file, unsigned line, const char *function, const char *fmt, const Args&... args )
+	{
+		using tuple_t = std::tuple<LogDetail::capture_t<Args>...>;
+
+		static_assert( sizeof(tuple_t) <= ARGS_SIZE, "too many arguments for the async log" );
+		static_assert( ( std::is_trivially_copyable_v<LogDetail::capture_t<Args>> && ... ),
+					   "argument not supported by the async log" );
+
+		Record record;
+		record.file      = file;
+		record.line      = line;
+		record.function  = function;
+		record.fmt       = fmt;
+		record.timestamp = clock::now();
+		record.render    = &render<tuple_t>;
+		new (record.args) tuple_t( LogDetail::capture_t<Args>( args )... );
+
+		while( !ring.push( record ) ) {
+			if( overflow == LogOverflow::DROP ) {
+				dropped.fetch_add( 1, std::memory_order_relaxed );
+				return;
+			}
+
+			std::this_thread::yield();
+		}
+	}
+
+	/**
+	 * formats and writes up to max messages,
+	 * only one thread is allowed to call this function
+	 */
+	std::size_t drain( std::size_t max = RING_SIZE )
+	{
+		std::size_t done = 0;
+		Record record;
+
+		const std::size_t lost = dropped.exchange( 0, std::memory_order_relaxed );
+
+		if( lost && Tools::x_debug ) {
+			Tools::x_debug->add( __FILE__, __LINE__, __FUNCTION__, Tools::format( "%d log messages dropped", lost ) );
+		}
+
+		while( done < max && ring.pop( record ) ) {
+			done++;
+
+			if( Tools::x_debug ) {
+				Tools::x_debug->add( record.file, record.line, record.function, record.render( record, time_formatter ) );
+			}
+		}
+
+		return done;
+	}
+
+	/**
+	 * Low priority drain coroutine for the scheduler.
+	 * It waits for a time, not for the log, so it is sorted behind
+	 * the tasks waiting for objects. With the slack of one period it
+	 * mostly runs together with other tasks, without an extra wakeup.
+	 * The period should be short enough, that RING_SIZE messages
+	 * are not exceeded in between.
+	 */
+	template<class Generator> Generator drain_task( std::chrono::nanoseconds period )
+	{
+		while( true ) {
+			drain();
+			co_yield YIELD( period, {}, period );
+		}
+	}
+
+	/**
+	 * drain function for a separate thread
+	 */
+	void drain_loop( const std::atomic<bool> & stop, std::chrono::nanoseconds period )
+	{
+		while( !stop.load( std::memory_order_acquire ) ) {
+			if( !drain() ) {
+				std::this_thread::sleep_for( period );
+			}
+		}
+
+		drain();
+	}
+
+private:
+	static std::string default_time_formatter( clock::time_point tp )
+	{
+		const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>( tp.time_since_epoch() ).count();
+		return Tools::format( "%d.%03d", ms / 1000, ms % 1000 );
+	}
+
+	template<class T> static const T & unwrap( const T & arg, const Record &, time_formatter_t ) {
+		return arg;
+	}
+
+	static const char* unwrap( const LogDetail::String & arg, const Record &, time_formatter_t ) {
+		return arg.text;
+	}
+
+	static std::string unwrap( const log_timestamp &, const Record & record, time_formatter_t time_formatter ) {
+		return time_formatter( record.timestamp );
+	}
+
+	template<class tuple_t>
+	static std::string render( const Record & record, time_formatter_t time_formatter )
+	{
+		const tuple_t & args = *std::launder( reinterpret_cast<const tuple_t*>( record.args ) );
+
+		return std::apply( [&record,time_formatter]( const auto&... arg ) {
+			return Tools::format( record.fmt, unwrap( arg, record, time_formatter )... );
+		}, args );
+	}
+};
+
+} // namespace CoScheduler
+
+#define CO_DEBUG( log, fmt, ... ) (log).add( __FILE__, __LINE__, __FUNCTION__, fmt __VA_OPT__(,) __VA_ARGS__ )
+
+#endif /* SRC_COSCHEDULER_COLOG_HPP_ */
@@ -0,0 +1,156 @@
+/**
+ * Waiting for child processes via pidfd (linux only)
+ * @author Copyright (c) 2024 Martin Oberzalek
+ */
+#pragma once
+#ifndef SRC_COSCHEDULER_COPROCESS_HPP_
+#define SRC_COSCHEDULER_COPROCESS_HPP_
+
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdint>
+#include <system_error>
+#include "CoScheduler.hpp"
+#include "CoReactor.hpp"
+
+#ifndef P_PIDFD
+#define P_PIDFD 3
+#endif
+
+namespace CoScheduler {
+
+/**
+ * Exit of a child process as event on the reactor,
+ * instead of polling waitpid() periodically.
+ *
+ *   CoScheduler::ProcessExit child( sch.get_idle_waiter(), pid );
+ *
+ *   const YIELD & r = co_yield YIELD( child, 10s );
+ *
+ *   if( r.timed_out() ) {
+ *     child.send_signal( SIGKILL );
+ *     co_yield YIELD( child );
+ *   }
+ *
+ *   if( WIFEXITED( child.status() ) ) {
+ *     ...
+ *   }
+ *
+ * The child is reaped, as soon as the exit is reported,
+ * so the pid must not be waited for somewhere else.
+ */
+class ProcessExit : public WaitForBase, public Reactor::Handler
+{
+	Reactor & reactor;
+	const pid_t pid;
+	int fd = -1;
+	bool exited = false;
+	int exit_status = 0;
+
+public:
+	ProcessExit( Reactor & reactor_, pid_t pid_ )
+	: reactor( reactor_ ),
+	  pid( pid_ )
+	{
+		fd = static_cast<int>( syscall( SYS_pidfd_open, pid, 0 ) );
+
+		if( fd < 0 ) {
+			throw std::system_error( errno, std::generic_category(), "pidfd_open" );
+		}
+
+		// a child, that already exited, is reported immediately
+		const int err = reactor.add( fd, EPOLLIN, *this );
+
+		if( err < 0 ) {
+			close( fd );
+			throw std::system_error( -err, std::generic_category(), "epoll_ctl" );
+		}
+	}
+
+	~ProcessExit()
+	{
+		reactor.remove( fd );
+		close( fd );
+	}
+
+	ProcessExit( const ProcessExit & other ) = delete;
+	ProcessExit & operator=( const ProcessExit & other ) = delete;
+
+	bool condition_reached() const override {
+		return exited;
+	}
+
+	pid_t get_pid() const {
+		return pid;
+	}
+
+	bool has_exited() const {
+		return exited;
+	}
+
+	/**
+	 * status in the format of waitpid(),
+	 * use WIFEXITED(), WEXITSTATUS(), WIFSIGNALED(), ... to decode it.
+	 * Only valid, after the process has exited.
+	 */
+	int status() const {
+		return exit_status;
+	}
+
+	/**
+	 * sends a signal via the pidfd, so it can't hit
+	 * another process, that reused the pid.
+	 * returns 0 or -errno
+	 */
+	int send_signal( int sig )
+	{
+		if( syscall( SYS_pidfd_send_signal, fd, sig, nullptr, 0 ) < 0 ) {
+			return -errno;
+		}
+
+		return 0;
+	}
+
+	void on_event( std::uint32_t ) override
+	{
+		if( exited ) {
+			return;
+		}
+
+		siginfo_t info{};
+
+		if( waitid( static_cast<idtype_t>( P_PIDFD ), static_cast<id_t>( fd ), &info, WEXITED | WNOHANG ) < 0 ) {
+			return;
+		}
+
+		// WNOHANG and the child is still running
+		if( info.si_pid == 0 ) {
+			return;
+		}
+
+		switch( info.si_code )
+		{
+		case CLD_EXITED:
+			exit_status = ( info.si_status & 0xFF ) << 8;
+			break;
+
+		case CLD_DUMPED:
+			exit_status = info.si_status | 0x80;
+			break;
+
+		default:
+			exit_status = info.si_status;
+			break;
+		}
+
+		exited = true;
+	}
+};
+
+} // namespace CoScheduler
+
+#endif /* SRC_COSCHEDULER_COPROCESS_HPP_ */
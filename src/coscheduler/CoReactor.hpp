@@ -0,0 +1,255 @@
+/**
+ * epoll based reactor for waiting on file descriptors (linux only)
+ * @author Copyright (c) 2024 Martin Oberzalek
+ */
+#pragma once
+#ifndef SRC_COSCHEDULER_COREACTOR_HPP_
+#define SRC_COSCHEDULER_COREACTOR_HPP_
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <cstdint>
+#include <system_error>
+#include "CoScheduler.hpp"
+
+namespace CoScheduler {
+
+/**
+ * epoll instance, that can be used as Conf::IDLE_WAITER
+ *
+ *   struct ReactorConf : public DynamicConf
+ *   {
+ *     using IDLE_WAITER = CoScheduler::Reactor;
+ *
+ *     // all objects are changed by fd events, or with wakeup()
+ *     static constexpr std::chrono::nanoseconds MAX_IDLE = 1s;
+ *
+ *     inline static void idle( IDLE_WAITER & waiter, std::chrono::nanoseconds timeout ) {
+ *       waiter.wait_for( timeout );
+ *     }
+ *   };
+ *
+ * Instead of sleeping, the scheduler waits in epoll_wait() and
+ * continues as soon as one of the registered file descriptors
+ * gets ready. When the scheduler is busy, the events are fetched
+ * without waiting at the start of each schedule() run.
+ */
+class Reactor
+{
+public:
+	/**
+	 * Base class for everything that is registered at the reactor.
+	 */
+	class Handler
+	{
+	public:
+		virtual ~Handler() {}
+
+		virtual void on_event( std::uint32_t events ) = 0;
+	};
+
+private:
+	static constexpr int MAX_EVENTS = 64;
+
+	int epoll_fd = -1;
+	int wakeup_fd = -1;
+	std::atomic<bool> notified = false;
+	epoll_event events[MAX_EVENTS];
+
+public:
+	Reactor()
+	{
+		epoll_fd = epoll_create1( EPOLL_CLOEXEC );
+
+		if( epoll_fd < 0 ) {
+			throw std::system_error( errno, std::generic_category(), "epoll_create1" );
+		}
+
+		wakeup_fd = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+
+		if( wakeup_fd < 0 ) {
+			close( epoll_fd );
+			throw std::system_error( errno, std::generic_category(), "eventfd" );
+		}
+
+		epoll_event event{};
+		event.events = EPOLLIN;
+		event.data.ptr = nullptr;
+
+		epoll_ctl( epoll_fd, EPOLL_CTL_ADD, wakeup_fd, &event );
+	}
+
+	~Reactor()
+	{
+		close( wakeup_fd );
+		close( epoll_fd );
+	}
+
+	Reactor( const Reactor & other ) = delete;
+	Reactor & operator=( const Reactor & other ) = delete;
+
+	/**
+	 * registers the fd edge triggered
+	 */
+	int add( int fd, std::uint32_t event_mask, Handler & handler )
+	{
+		epoll_event event{};
+		event.events = event_mask | EPOLLET;
+		event.data.ptr = &handler;
+
+		if( epoll_ctl( epoll_fd, EPOLL_CTL_ADD, fd, &event ) < 0 ) {
+			return -errno;
+		}
+
+		return 0;
+	}
+
+	void remove( int fd )
+	{
+		epoll_ctl( epoll_fd, EPOLL_CTL_DEL, fd, nullptr );
+	}
+
+	void poll()
+	{
+		dispatch( 0 );
+	}
+
+	void wait_for( std::chrono::nanoseconds timeout )
+	{
+		if( !notified.load( std::memory_order_acquire ) ) {
+			// round up, otherwise we would wake up too early and spin
+			const auto ms = std::chrono::ceil<std::chrono::milliseconds>( timeout );
+			dispatch( static_cast<int>( ms.count() ) );
+		} else {
+			dispatch( 0 );
+		}
+
+		notified.store( false, std::memory_order_release );
+	}
+
+	void notify()
+	{
+		if( notified.exchange( true, std::memory_order_acq_rel ) ) {
+			return;
+		}
+
+		const std::uint64_t one = 1;
+		[[maybe_unused]] auto ret = write( wakeup_fd, &one, sizeof(one) );
+	}
+
+private:
+	void dispatch( int timeout_ms )
+	{
+		const int count = epoll_wait( epoll_fd, events, MAX_EVENTS, timeout_ms );
+
+		for( int i = 0; i < count; i++ ) {
+
+			Handler *handler = static_cast<Handler*>( events[i].data.ptr );
+
+			if( !handler ) {
+				std::uint64_t value = 0;
+				[[maybe_unused]] auto ret = read( wakeup_fd, &value, sizeof(value) );
+				continue;
+			}
+
+			handler->on_event( events[i].events );
+		}
+	}
+};
+
+/**
+ * Readiness of one file descriptor. The fd has to be non blocking.
+ *
+ *   CoScheduler::FdWaiter conn( sch.get_idle_waiter(), fd );
+ *
+ *   while( true ) {
+ *     ssize_t len = read( fd, buffer, sizeof(buffer) );
+ *
+ *     if( len < 0 && errno == EAGAIN ) {
+ *       co_yield YIELD( conn.readable() );
+ *       continue;
+ *     }
+ *     ...
+ *   }
+ *
+ * Since the fd is registered edge triggered, readable() and writable()
+ * have to be called only after the last read or write returned EAGAIN.
+ * Errors and hangups wake up both directions, so the next read or
+ * write call reports them.
+ */
+class FdWaiter : public Reactor::Handler
+{
+	class Ready : public WaitForBase
+	{
+	public:
+		bool ready = false;
+
+		bool condition_reached() const override {
+			return ready;
+		}
+	};
+
+	Reactor & reactor;
+	const int fd;
+	Ready read_ready;
+	Ready write_ready;
+
+public:
+	FdWaiter( Reactor & reactor_, int fd_ )
+	: reactor( reactor_ ),
+	  fd( fd_ )
+	{
+		const int err = reactor.add( fd, EPOLLIN | EPOLLOUT | EPOLLRDHUP, *this );
+
+		if( err < 0 ) {
+			throw std::system_error( -err, std::generic_category(), "epoll_ctl" );
+		}
+	}
+
+	~FdWaiter()
+	{
+		reactor.remove( fd );
+	}
+
+	FdWaiter( const FdWaiter & other ) = delete;
+	FdWaiter & operator=( const FdWaiter & other ) = delete;
+
+	int get_fd() const {
+		return fd;
+	}
+
+	WaitForBase & readable() {
+		read_ready.ready = false;
+		return read_ready;
+	}
+
+	WaitForBase & writable() {
+		write_ready.ready = false;
+		return write_ready;
+	}
+
+	void on_event( std::uint32_t events ) override
+	{
+		if( events & ( EPOLLERR | EPOLLHUP ) ) {
+			read_ready.ready = true;
+			write_ready.ready = true;
+			return;
+		}
+
+		if( events & ( EPOLLIN | EPOLLRDHUP ) ) {
+			read_ready.ready = true;
+		}
+
+		if( events & EPOLLOUT ) {
+			write_ready.ready = true;
+		}
+	}
+};
+
+} // namespace CoScheduler
+
+#endif /* SRC_COSCHEDULER_COREACTOR_HPP_ */
@@ -0,0 +1,190 @@
+/**
+ * Reader writer lock for coroutines
+ * @author Copyright (c) 2024 Martin Oberzalek
+ */
+#pragma once
+#ifndef SRC_COSCHEDULER_CORWMUTEX_HPP_
+#define SRC_COSCHEDULER_CORWMUTEX_HPP_
+
+#include "CoScheduler.hpp"
+
+namespace CoScheduler {
+
+/**
+ * Many readers or one writer.
+ *
+ * Writers are preferred: as soon as a writer is waiting, only
+ * max_reader_batch further readers are let in, after that the
+ * readers have to wait until the writer is done.
+ * When a writer gets the lock, or the last waiting writer gives up,
+ * the batch starts again, so readers can't starve either.
+ *
+ * Since all waiting readers are checked within one schedule() run,
+ * all of them get the lock in the same run.
+ *
+ * Usage:
+ *
+ *   auto lock = my_rw_mutex.shared();
+ *   while( !lock.try_lock() ) {
+ *       co_yield YIELD( lock );
+ *   }
+ *   ...
+ *   my_rw_mutex.unlock_shared();
+ *
+ *   auto lock = my_rw_mutex.exclusive();
+ *   while( !lock.try_lock() ) {
+ *       co_yield YIELD( lock );
+ *   }
+ *   ...
+ *   my_rw_mutex.unlock();
+ *
+ * All functions have to be called from the scheduler thread.
+ */
+class rw_mutex
+{
+	unsigned readers = 0;
+	bool     writer = false;
+	unsigned writers_waiting = 0;
+	unsigned reader_batch = 0;
+	const unsigned max_reader_batch;
+
+public:
+	class shared_waiter : public WaitForBase
+	{
+		rw_mutex & m;
+
+	public:
+		shared_waiter( rw_mutex & m_ )
+		: m( m_ )
+		{}
+
+		shared_waiter( const shared_waiter & other ) = delete;
+		shared_waiter & operator=( const shared_waiter & other ) = delete;
+
+		bool try_lock() {
+			return m.try_lock_shared();
+		}
+
+		bool condition_reached() const override {
+			return m.can_lock_shared();
+		}
+	};
+
+	/**
+	 * registers itself as waiting writer at the first
+	 * failed try_lock() call, till the lock is acquired,
+	 * or the waiter is destroyed
+	 */
+	class exclusive_waiter : public WaitForBase
+	{
+		rw_mutex & m;
+		bool waiting = false;
+
+	public:
+		exclusive_waiter( rw_mutex & m_ )
+		: m( m_ )
+		{}
+
+		exclusive_waiter( const exclusive_waiter & other ) = delete;
+		exclusive_waiter & operator=( const exclusive_waiter & other ) = delete;
+
+		~exclusive_waiter() {
+			stop_waiting();
+		}
+
+		bool try_lock() {
+			if( m.try_lock() ) {
+				stop_waiting();
+				return true;
+			}
+
+			if( !waiting ) {
+				waiting = true;
+				m.writers_waiting++;
+			}
+
+			return false;
+		}
+
+		bool condition_reached() const override {
+			return m.can_lock();
+		}
+
+	private:
+		void stop_waiting() {
+			if( waiting ) {
+				waiting = false;
+				m.writers_waiting--;
+
+				// the writer gave up, the next one starts a new batch
+				if( m.writers_waiting == 0 ) {
+					m.reader_batch = 0;
+				}
+			}
+		}
+	};
+
+public:
+	rw_mutex( unsigned max_reader_batch_ = 8 )
+	: max_reader_batch( max_reader_batch_ )
+	{}
+
+	rw_mutex( const rw_mutex & other ) = delete;
+	rw_mutex & operator=( const rw_mutex & other ) = delete;
+
+	shared_waiter shared() {
+		return shared_waiter( *this );
+	}
+
+	exclusive_waiter exclusive() {
+		return exclusive_waiter( *this );
+	}
+
+	bool can_lock() const {
+		return !writer && readers == 0;
+	}
+
+	bool can_lock_shared() const {
+		if( writer ) {
+			return false;
+		}
+
+		return writers_waiting == 0 || reader_batch < max_reader_batch;
+	}
+
+	bool try_lock() {
+		if( !can_lock() ) {
+			return false;
+		}
+
+		writer = true;
+		reader_batch = 0;
+		return true;
+	}
+
+	void unlock() {
+		writer = false;
+	}
+
+	bool try_lock_shared() {
+		if( !can_lock_shared() ) {
+			return false;
+		}
+
+		readers++;
+
+		if( writers_waiting > 0 ) {
+			reader_batch++;
+		}
+
+		return true;
+	}
+
+	void unlock_shared() {
+		readers--;
+	}
+};
+
+} // namespace CoScheduler
+
+#endif /* SRC_COSCHEDULER_CORWMUTEX_HPP_ */
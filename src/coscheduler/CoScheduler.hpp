@@ -9,21 +9,222 @@
 #include <coroutine>
 #include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <limits>
+#include <new>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <format.h>
+#include <OutDebug.h>
 #include "CoGenerator.hpp"
+#include "CoFramePool.hpp"
+#include "CoInbox.hpp"
+#include "CoIdleWaiter.hpp"
 
 namespace CoScheduler {
 
 class WaitForBase;
 
+/**
+ * Cooperative cancellation of tasks.
+ *
+ * A task, that is added with a token, is resumed immediately with
+ * WakeupReason::CANCELLED, after the token has been cancelled,
+ * even if it is waiting for an object or for a time. This holds for
+ * every following co_yield too, till the task returns.
+ *
+ *   CoScheduler::CancelToken request;
+ *   CoScheduler::CancelToken sub_request( &request );
+ *
+ *   sch.add_task_reference( task, request );
+ *   sch.add_task_reference( sub_task, sub_request );
+ *
+ *   // cancels both tasks
+ *   request.cancel();
+ *
+ *   // in the task
+ *   const YIELD & r = co_yield YIELD( my_mutex );
+ *   if( r.cancelled() ) {
+ *     co_return;
+ *   }
+ *
+ * Cancelling a parent cancels all its children, so a whole tree of
+ * tasks can be stopped at once. The parent has to live longer than
+ * its children. cancel() can be called from any thread, call
+ * Scheduler::wakeup() afterwards in this case.
+ */
+class CancelToken
+{
+	std::atomic<bool> cancel_requested = false;
+	const CancelToken *parent;
+
+public:
+	CancelToken( const CancelToken *parent_ = nullptr )
+	: parent( parent_ )
+	{}
+
+	CancelToken( const CancelToken & other ) = delete;
+	CancelToken & operator=( const CancelToken & other ) = delete;
+
+	void cancel() {
+		cancel_requested.store( true, std::memory_order_release );
+	}
+
+	bool is_cancelled() const
+	{
+		for( const CancelToken *token = this; token; token = token->parent ) {
+			if( token->cancel_requested.load( std::memory_order_acquire ) ) {
+				return true;
+			}
+		}
+
+		return false;
+	}
+};
+
+/**
+ * node in the list of tasks, that are owned by the scheduler,
+ * see Scheduler::spawn()
+ */
+struct SpawnedTask
+{
+	SpawnedTask *prev = nullptr;
+	SpawnedTask *next = nullptr;
+};
+
+/**
+ * runtime statistics of a task, collected by the scheduler
+ */
+struct TaskStats
+{
+	std::uint64_t resumes = 0;
+	std::chrono::nanoseconds runtime{};
+	std::chrono::nanoseconds last_runtime{};
+
+	void add( std::chrono::nanoseconds duration ) {
+		resumes++;
+		runtime += duration;
+		last_runtime = duration;
+	}
+
+	std::chrono::nanoseconds average() const {
+		return resumes ? runtime / static_cast<std::int64_t>( resumes ) : std::chrono::nanoseconds( 0 );
+	}
+};
+
+/**
+ * why a task failed, see Scheduler::on_task_failed()
+ */
+struct TaskFailure
+{
+#if __cpp_exceptions
+	std::exception_ptr exception;
+#endif
+	std::error_code error;
+
+	explicit operator bool() const {
+#if __cpp_exceptions
+		if( exception ) {
+			return true;
+		}
+#endif
+		return static_cast<bool>( error );
+	}
+
+	// what() of the exception, or the message of the error code
+	std::string describe() const
+	{
+#if __cpp_exceptions
+		if( exception ) {
+			try {
+				std::rethrow_exception( exception );
+			} catch( const std::exception & error ) {
+				return error.what();
+			} catch( ... ) {
+				return "unknown exception";
+			}
+		}
+#endif
+		return error.message();
+	}
+};
+
+/**
+ * The task, a scheduler is resuming right now, published
+ * for a Watchdog running in an other thread.
+ * See Scheduler::set_running_task_monitor()
+ */
+struct RunningTask
+{
+	// incremented after each update, the fields are only consistent,
+	// if sequence is the same before and after reading them
+	std::atomic<std::uint64_t> sequence = 0;
+
+	// nullptr while no task is running
+	std::atomic<const void*> task = nullptr;
+	// steady_clock, so a changed system time doesn't look like an overrun
+	std::atomic<std::int64_t> since_ns = 0;
+	std::atomic<std::int64_t> expected_ns = 0;
+	std::atomic<std::uint64_t> resumes = 0;
+	std::atomic<std::size_t> task_count = 0;
+
+	void begin( const void *task_, std::chrono::nanoseconds since,
+				std::chrono::nanoseconds expected, std::uint64_t resumes_, std::size_t task_count_ )
+	{
+		since_ns.store( since.count(), std::memory_order_relaxed );
+		expected_ns.store( expected.count(), std::memory_order_relaxed );
+		resumes.store( resumes_, std::memory_order_relaxed );
+		task_count.store( task_count_, std::memory_order_relaxed );
+		task.store( task_, std::memory_order_relaxed );
+		sequence.fetch_add( 1, std::memory_order_release );
+	}
+
+	void end()
+	{
+		task.store( nullptr, std::memory_order_relaxed );
+		sequence.fetch_add( 1, std::memory_order_release );
+	}
+};
+
 struct YIELD
 {
 	using clock = std::chrono::high_resolution_clock;
 	using timepoint_t = std::chrono::time_point<clock>;
 
+	/**
+	 * why the task has been resumed, set by the scheduler
+	 */
+	enum class WakeupReason
+	{
+		TIME,
+		OBJECT,
+		TIMEOUT,
+		CANCELLED
+	};
+
 	timepoint_t last_run;
 	timepoint_t next_run;
 	std::chrono::nanoseconds expected_duration;
+
+	/**
+	 * the task may run up to slack later than next_run.
+	 * Tasks, whose windows overlap, are resumed together,
+	 * so the scheduler has to wake up only once.
+	 */
+	std::chrono::nanoseconds slack{};
 	WaitForBase *wait_for_object = nullptr;
+	bool has_timeout = false;
+	WakeupReason wakeup_reason = WakeupReason::TIME;
+
+	/**
+	 * set by the scheduler, kept across all co_yield calls of the task
+	 */
+	TaskStats stats;
+	CancelToken *cancel_token = nullptr;
+	SpawnedTask *spawned = nullptr;
 
 	YIELD()
 	: last_run( clock::now() ),
@@ -37,11 +238,52 @@ struct YIELD
 		wait_for_object = &wait_for_object_;
 	}
 
-	YIELD( std::chrono::nanoseconds next_run_in, std::chrono::nanoseconds expected_duration_ = {} )
+	/**
+	 * co_yield YIELD( 1000ms, 1ms, 20ms );
+	 */
+	YIELD( std::chrono::nanoseconds next_run_in,
+		   std::chrono::nanoseconds expected_duration_ = {},
+		   std::chrono::nanoseconds slack_ = {} )
 	: last_run( clock::now() ),
 	  next_run( last_run + next_run_in ),
-	  expected_duration( expected_duration_ )
+	  expected_duration( expected_duration_ ),
+	  slack( slack_ )
 	{}
+
+	/**
+	 * wait for the object, but at most for timeout.
+	 * The timeout is handled like a normal next_run time, without slack.
+	 *
+	 * const YIELD & result = co_yield YIELD( my_mutex, 50ms );
+	 * if( result.timed_out() ) {
+	 *   ...
+	 * }
+	 *
+	 * The result is valid till the next co_yield.
+	 */
+	YIELD( WaitForBase & wait_for_object_, std::chrono::nanoseconds timeout )
+	: YIELD( timeout )
+	{
+		wait_for_object = &wait_for_object_;
+		has_timeout = true;
+	}
+
+	bool timed_out() const {
+		return wakeup_reason == WakeupReason::TIMEOUT;
+	}
+
+	bool cancelled() const {
+		return wakeup_reason == WakeupReason::CANCELLED;
+	}
+
+	bool cancel_requested() const {
+		return cancel_token && cancel_token->is_cancelled();
+	}
+
+	/**
+	 * checks if the task can be resumed and stores the wakeup_reason
+	 */
+	bool ready( timepoint_t now );
 };
 
 class WaitForBase
@@ -52,6 +294,69 @@ public:
 	virtual bool condition_reached() const = 0;
 };
 
+/**
+ * one resume of a task, from the resume till the next co_yield
+ */
+struct TaskRun
+{
+	const void *task;
+	// of the resume, steady_clock
+	std::chrono::steady_clock::time_point start;
+	std::chrono::steady_clock::time_point end;
+
+	// why the task has been resumed, and the object it was waiting for
+	YIELD::WakeupReason wakeup_reason;
+	const WaitForBase *waited_for;
+
+	// what the task waits for now, only valid, if it is not finished.
+	// next_run_in is the time till next_run, or the timeout, 0 if the
+	// task runs again at the next schedule() run
+	const WaitForBase *waits_for;
+	std::chrono::nanoseconds next_run_in;
+	bool finished;
+};
+
+/**
+ * Receives each run of a task, see Scheduler::set_tracer()
+ * and ChromeTrace. Called by the scheduler thread.
+ */
+class TaskTracer
+{
+public:
+	virtual ~TaskTracer() {}
+
+	virtual void task_ran( const TaskRun & run ) = 0;
+};
+
+inline bool YIELD::ready( timepoint_t now )
+{
+	if( cancel_requested() ) {
+		wakeup_reason = WakeupReason::CANCELLED;
+		return true;
+	}
+
+	if( wait_for_object ) {
+		if( wait_for_object->condition_reached() ) {
+			wakeup_reason = WakeupReason::OBJECT;
+			return true;
+		}
+
+		if( has_timeout && next_run <= now ) {
+			wakeup_reason = WakeupReason::TIMEOUT;
+			return true;
+		}
+
+		return false;
+	}
+
+	if( next_run <= now ) {
+		wakeup_reason = WakeupReason::TIME;
+		return true;
+	}
+
+	return false;
+}
+
 template<class T> class WaitFor : public WaitForBase
 {
 public:
@@ -92,36 +397,315 @@ public:
 /*
 struct Conf
 {
+	// CoGenerator<YIELD,ErrorModel::ERROR_CODES> for builds without exceptions
 	using yield_type = CoGenerator<YIELD>;
 
-	static constexpr unsigned MAX_TASKS = 10;
+	static constexpr unsigned MAX_TASKS = 10; // optional, default for set_task_limit()
 	static constexpr unsigned MAX_WAITABLE_OBJECTS = 10;
 	static constexpr unsigned MAX_WAIT_OBJECTS = 10;
+	static constexpr unsigned MAX_REMOTE_TASKS = 8; // has to be a power of two
 
 	using CONTAINER_TASKS            = Tools::CyclicArray<yield_type*,MAX_TASKS>;
 	using CONTAINER_WAITABLE_OBJECTS = Tools::CyclicArray<WaitForBase*,MAX_WAITABLE_OBJECTS>;
 	using CONTAINER_WAIT_OBJECTS     = Tools::CyclicArray<WaitForBase*,MAX_WAIT_OBJECTS>;
+
+	// optional, defaults to VectorInbox<yield_type*>
+	using CONTAINER_REMOTE_TASKS     = Inbox<yield_type*,MAX_REMOTE_TASKS>;
+
+	// optional, defaults to NoIdleWaiter
+	using IDLE_WAITER = IdleWaiter;
+
+	// optional, longest timeout passed to idle(), defaults to 10ms.
+	// Objects changed without wakeup(), eg. by an interrupt, are noticed after that time.
+	static constexpr std::chrono::nanoseconds MAX_IDLE = std::chrono::milliseconds( 10 );
+
+	// timeout: time till the next task has to run, at most MAX_IDLE
+	// idle( IDLE_WAITER & waiter ) and idle() are still supported
+	static void idle( IDLE_WAITER & waiter, std::chrono::nanoseconds timeout );
 };
 */
 
+/**
+ * Types of the optional Conf members, with defaults for
+ * configurations, that have been written before they existed.
+ */
+template<class Conf> struct ConfRemoteTasks
+{
+	using type = VectorInbox<typename Conf::yield_type*>;
+};
+
+template<class Conf> requires requires { typename Conf::CONTAINER_REMOTE_TASKS; }
+struct ConfRemoteTasks<Conf>
+{
+	using type = Conf::CONTAINER_REMOTE_TASKS;
+};
+
+template<class Conf> struct ConfIdleWaiter
+{
+	using type = NoIdleWaiter;
+};
+
+template<class Conf> requires requires { typename Conf::IDLE_WAITER; }
+struct ConfIdleWaiter<Conf>
+{
+	using type = Conf::IDLE_WAITER;
+};
+
 template<class Conf> class Scheduler
 {
 public:
 	using yield_type = Conf::yield_type;
+	using idle_waiter_type = ConfIdleWaiter<Conf>::type;
 
 protected:
+	struct OwnedTask : public SpawnedTask
+	{
+		yield_type task;
+
+		OwnedTask( yield_type && task_ )
+		: task( std::move( task_ ) )
+		{}
+	};
+
+	class TaskCapacity : public WaitForBase
+	{
+		const Scheduler & scheduler;
+
+	public:
+		TaskCapacity( const Scheduler & scheduler_ )
+		: scheduler( scheduler_ )
+		{}
+
+		bool condition_reached() const override {
+			return scheduler.has_task_capacity();
+		}
+	};
+
 	Conf::CONTAINER_TASKS            tasks;
 	Conf::CONTAINER_WAITABLE_OBJECTS waitable_objects;
 	Conf::CONTAINER_WAIT_OBJECTS     wait_for_objects;
+	ConfRemoteTasks<Conf>::type      remote_tasks;
+	idle_waiter_type                 idle_waiter;
+	std::atomic<bool>                stop_requested = false;
+	SpawnedTask                     *spawned_tasks = nullptr;
+	std::size_t                      task_limit = default_task_limit();
+	TaskCapacity                     task_capacity_waiter{ *this };
+	bool                             tasks_removed = false;
+	bool                             isolate_faults = false;
+	std::atomic<RunningTask*>        running_task = nullptr;
+	std::chrono::nanoseconds         drain_timeout = std::chrono::seconds( 1 );
+
+	// sum of the runtimes of all resumed tasks
+	std::chrono::nanoseconds         busy_time{};
+	TaskTracer                      *tracer = nullptr;
 
 public:
-	virtual ~Scheduler() {};
+	/**
+	 * destroys all spawned tasks, that are not finished yet
+	 */
+	virtual ~Scheduler()
+	{
+		while( spawned_tasks ) {
+			destroy_spawned( static_cast<OwnedTask*>( spawned_tasks ) );
+		}
+	}
 
 
 	void add_task_reference( yield_type & h ) {
 		tasks.push_back( &h );
 	}
 
+	/**
+	 * the task can be cancelled with the token, see CancelToken
+	 */
+	void add_task_reference( yield_type & h, CancelToken & token ) {
+		h.get_handle().promise().value_.cancel_token = &token;
+		tasks.push_back( &h );
+	}
+
+	/**
+	 * The scheduler forgets the task, without destroying it.
+	 * Can be called by a running task too, the removed task
+	 * won't be resumed anymore.
+	 */
+	void remove_task_reference( yield_type & h ) {
+		erase_task( &h );
+		tasks_removed = true;
+	}
+
+	/**
+	 * The scheduler takes over the task and frees it, when it is finished.
+	 * So the caller doesn't have to keep the generator alive:
+	 *
+	 *   sch.spawn( handle_request<Scheduler::yield_type>( conn ) );
+	 *
+	 * The frames of the coroutines and the list nodes are
+	 * recycled by the FramePool of the thread.
+	 */
+	void spawn( yield_type && task ) {
+		tasks.push_back( &adopt( std::move( task ) ) );
+	}
+
+	void spawn( yield_type && task, CancelToken & token ) {
+		task.get_handle().promise().value_.cancel_token = &token;
+		spawn( std::move( task ) );
+	}
+
+	/**
+	 * Maximum number of live tasks for try_spawn() and spawn_or_wait().
+	 * Defaults to Conf::MAX_TASKS, if defined, otherwise to unlimited.
+	 * spawn() and add_task_reference() are not limited.
+	 */
+	void set_task_limit( std::size_t limit ) {
+		task_limit = limit;
+	}
+
+	std::size_t get_task_limit() const {
+		return task_limit;
+	}
+
+	bool has_task_capacity() const {
+		return tasks.size() < task_limit;
+	}
+
+	/**
+	 * ready, when an other task can be spawned
+	 */
+	WaitForBase & task_capacity() {
+		return task_capacity_waiter;
+	}
+
+	/**
+	 * spawns the task, if the limit is not reached yet,
+	 * otherwise task stays untouched and false is returned.
+	 */
+	bool try_spawn( yield_type & task )
+	{
+		if( !has_task_capacity() ) {
+			return false;
+		}
+
+		spawn( std::move( task ) );
+		return true;
+	}
+
+	/**
+	 * Sub coroutine, that waits till the task can be spawned:
+	 *
+	 *   auto spawner = sch.spawn_or_wait<Scheduler::yield_type>( handle_request<Scheduler::yield_type>( conn ) );
+	 *
+	 *   while( spawner ) {
+	 *     co_yield spawner();
+	 *   }
+	 *
+	 * So under overload the spawning task is slowed down,
+	 * instead of the tasks container growing without limit.
+	 */
+	template<class Generator> Generator spawn_or_wait( yield_type task )
+	{
+		while( !try_spawn( task ) ) {
+			co_yield YIELD( task_capacity_waiter );
+		}
+	}
+
+	/**
+	 * Thread safe version of add_task_reference().
+	 * The task is moved into the tasks list at the start of the next schedule() call.
+	 * A sleeping scheduler will be woken up.
+	 * Returns false, if the remote inbox is full.
+	 */
+	bool add_remote_task_reference( yield_type & h ) {
+		if( !remote_tasks.push( &h ) ) {
+			return false;
+		}
+
+		wakeup();
+		return true;
+	}
+
+	/**
+	 * interrupts idle(), can be called from any thread
+	 */
+	void wakeup() {
+		idle_waiter.notify();
+	}
+
+	idle_waiter_type & get_idle_waiter() {
+		return idle_waiter;
+	}
+
+	/**
+	 * Lets infinite_schedule() return, can be called from any thread.
+	 * Tasks, that are ready to run, are still resumed, till there
+	 * is nothing more to do, but at most for the drain timeout.
+	 * Tasks waiting for a time or an object
+	 * stay suspended, they are not destroyed by the scheduler.
+	 *
+	 * infinite_schedule() resets the request, when it returns,
+	 * so it can be called again afterwards. See also reset_stop().
+	 */
+	void stop() {
+		stop_requested.store( true, std::memory_order_release );
+		wakeup();
+	}
+
+	bool is_stopping() const {
+		return stop_requested.load( std::memory_order_acquire );
+	}
+
+	/**
+	 * withdraws a stop(), that has not been handled yet
+	 */
+	void reset_stop() {
+		stop_requested.store( false, std::memory_order_release );
+	}
+
+	/**
+	 * Maximum time, infinite_schedule() keeps resuming ready tasks after stop().
+	 * Periodic tasks of an overloaded scheduler are always ready,
+	 * the drain would never end otherwise.
+	 */
+	void set_drain_timeout( std::chrono::nanoseconds timeout ) {
+		drain_timeout = timeout;
+	}
+
+	/**
+	 * If enabled, an exception thrown by a task is caught by schedule()
+	 * and passed to on_task_failed(), the task is removed and all other
+	 * tasks keep running. Otherwise the exception is thrown out of schedule().
+	 * To restart failed tasks, see Supervisor.
+	 */
+	void set_fault_isolation( bool isolate ) {
+		isolate_faults = isolate;
+	}
+
+	bool get_fault_isolation() const {
+		return isolate_faults;
+	}
+
+	/**
+	 * Each resumed task is published to the monitor, so a watchdog
+	 * can detect tasks, that don't co_yield in time, see Watchdog.
+	 * nullptr disables it. Can be called from any thread, but a replaced
+	 * monitor may still be written, till the running resume has finished,
+	 * so it has to be kept, till the scheduler is stopped in that case.
+	 */
+	void set_running_task_monitor( RunningTask *monitor ) {
+		running_task.store( monitor, std::memory_order_release );
+	}
+
+	/**
+	 * Each resume of a task is reported to the tracer, see ChromeTrace.
+	 * Has to be set before the scheduler is started, nullptr disables it.
+	 */
+	void set_tracer( TaskTracer *tracer_ ) {
+		tracer = tracer_;
+	}
+
+	/**
+	 * Resumes all tasks, that are ready. Returns false, if no task
+	 * has been resumed, also if tasks are waiting for objects.
+	 */
 	virtual bool schedule();
 	virtual void idle();
 	virtual void infinite_schedule();
@@ -135,7 +719,41 @@ public:
 	}
 
 protected:
-	void remove_task( yield_type* task );
+	static constexpr std::size_t default_task_limit()
+	{
+		if constexpr( requires { Conf::MAX_TASKS; } ) {
+			return Conf::MAX_TASKS;
+		} else {
+			return std::numeric_limits<std::size_t>::max();
+		}
+	}
+
+	static constexpr std::chrono::nanoseconds max_idle()
+	{
+		if constexpr( requires { Conf::MAX_IDLE; } ) {
+			return Conf::MAX_IDLE;
+		} else {
+			return std::chrono::milliseconds( 10 );
+		}
+	}
+
+	/**
+	 * Called, when a task failed with an error code, or with an
+	 * exception, if fault isolation is enabled. Logs the failure by default.
+	 * The task is removed afterwards, a spawned task is destroyed.
+	 */
+	virtual void on_task_failed( yield_type & task, const TaskFailure & failure )
+	{
+		CPPDEBUG( Tools::format( "task %p failed: %s", static_cast<const void*>( &task ), failure.describe() ) );
+	}
+
+	virtual void remove_task( yield_type* task );
+	void erase_task( yield_type* task );
+	yield_type & adopt( yield_type && task );
+	yield_type release( yield_type* task );
+	void destroy_spawned( OwnedTask *owned );
+	YIELD::timepoint_t next_deadline();
+	void fetch_remote_tasks();
 
 };
 
@@ -143,25 +761,149 @@ protected:
 template<class Conf>
 void Scheduler<Conf>::idle()
 {
-	Conf::idle();
+	const auto deadline = next_deadline();
+	const auto now = YIELD::clock::now();
+	std::chrono::nanoseconds timeout( 0 );
+
+	if( deadline > now ) {
+		timeout = std::chrono::duration_cast<std::chrono::nanoseconds>( deadline - now );
+	}
+
+	// the deadline is timepoint_t::max(), if all tasks wait for objects
+	timeout = std::min( timeout, max_idle() );
+
+	if constexpr( requires { Conf::idle( idle_waiter, timeout ); } ) {
+		Conf::idle( idle_waiter, timeout );
+	} else if constexpr( requires { Conf::idle( idle_waiter ); } ) {
+		Conf::idle( idle_waiter );
+	} else {
+		Conf::idle();
+	}
+}
+
+/**
+ * the latest time, the next task has to be resumed,
+ * or timepoint_t::max(), if all tasks are waiting for objects
+ */
+template<class Conf>
+YIELD::timepoint_t Scheduler<Conf>::next_deadline()
+{
+	auto deadline = YIELD::timepoint_t::max();
+
+	for( yield_type *t : tasks ) {
+
+		const auto & value = t->get_handle().promise().value_;
+
+		if( value.wait_for_object && !value.has_timeout ) {
+			continue;
+		}
+
+		const auto task_deadline = value.wait_for_object ? value.next_run : value.next_run + value.slack;
+
+		if( task_deadline < deadline ) {
+			deadline = task_deadline;
+		}
+	}
+
+	return deadline;
 }
 
 
 template<class Conf>
 void Scheduler<Conf>::infinite_schedule()
 {
-	while( true ) {
+	while( !is_stopping() ) {
 		if( !schedule() ) {
 			idle();
 		}
 	}
+
+	// drain
+	const auto deadline = std::chrono::steady_clock::now() + drain_timeout;
+
+	while( schedule() && std::chrono::steady_clock::now() < deadline ) {
+	}
+
+	reset_stop();
 }
 
 template<class Conf>
 void Scheduler<Conf>::remove_task( yield_type* task )
 {
-	task->get_handle().destroy();
+	if( SpawnedTask *spawned = task->get_handle().promise().value_.spawned ) {
+		erase_task( task );
+		destroy_spawned( static_cast<OwnedTask*>( spawned ) );
+		return;
+	}
+
+	// reset() clears the handle, so the destructor of the generator,
+	// which is owned by the caller, doesn't destroy the frame again
+	task->reset();
+	erase_task( task );
+}
+
+/**
+ * moves the task into a node of the spawned tasks list
+ */
+template<class Conf>
+Scheduler<Conf>::yield_type & Scheduler<Conf>::adopt( yield_type && task )
+{
+	void *mem = FramePool::allocate_frame( sizeof(OwnedTask) );
+	OwnedTask *owned = new (mem) OwnedTask( std::move( task ) );
+
+	owned->next = spawned_tasks;
+
+	if( spawned_tasks ) {
+		spawned_tasks->prev = owned;
+	}
+
+	spawned_tasks = owned;
+
+	owned->task.get_handle().promise().value_.spawned = owned;
+
+	return owned->task;
+}
+
+/**
+ * Takes a spawned task out of the scheduler, without destroying it.
+ * The task has to be suspended.
+ */
+template<class Conf>
+Scheduler<Conf>::yield_type Scheduler<Conf>::release( yield_type* task )
+{
+	OwnedTask *owned = static_cast<OwnedTask*>( task->get_handle().promise().value_.spawned );
+
+	erase_task( task );
+
+	yield_type released( std::move( owned->task ) );
+	released.get_handle().promise().value_.spawned = nullptr;
+
+	destroy_spawned( owned );
+
+	return released;
+}
+
+template<class Conf>
+void Scheduler<Conf>::destroy_spawned( OwnedTask *owned )
+{
+	if( owned->prev ) {
+		owned->prev->next = owned->next;
+	} else {
+		spawned_tasks = owned->next;
+	}
+
+	if( owned->next ) {
+		owned->next->prev = owned->prev;
+	}
+
+	// the destructor of the generator destroys the frame
+	owned->~OwnedTask();
+	FramePool::deallocate_frame( owned, sizeof(OwnedTask) );
+}
 
+template<class Conf>
+void Scheduler<Conf>::erase_task( yield_type* task )
+{
 	for( auto it = tasks.begin(); it != tasks.end(); it++ ) {
 		if( *it == task ) {
 			tasks.erase(it);
@@ -170,18 +912,38 @@ void Scheduler<Conf>::remove_task( yield_type* task )
 	}
 }
 
+template<class Conf>
+void Scheduler<Conf>::fetch_remote_tasks()
+{
+	yield_type *task = nullptr;
+
+	while( remote_tasks.pop( task ) ) {
+		tasks.push_back( task );
+	}
+}
+
 template<class Conf>
 bool Scheduler<Conf>::schedule()
 {
+	fetch_remote_tasks();
+	idle_waiter.poll();
+
 	typename Conf::CONTAINER_TASKS generators;
 	const auto tp = YIELD::clock::now();
+	bool deadline_reached = false;
 
 	for( yield_type *t : tasks ) {
 
 		const auto & value = t->get_handle().promise().value_;
 
-		if( value.next_run  <= tp ) {
+		// tasks waiting for an object are checked in any case,
+		// the object may be ready before the timeout is reached
+		if( value.wait_for_object || value.next_run <= tp || value.cancel_requested() ) {
 			generators.push_back( t );
+
+			if( !value.wait_for_object && value.next_run + value.slack <= tp ) {
+				deadline_reached = true;
+			}
 		}
 	}
 
@@ -217,25 +979,115 @@ bool Scheduler<Conf>::schedule()
 	}
 #endif
 
+	bool resumed = false;
+	tasks_removed = false;
+
 	for( auto gen : generators ) {
 
+		// removed by an other task in this run
+		if( tasks_removed && std::find( tasks.begin(), tasks.end(), gen ) == tasks.end() ) {
+			continue;
+		}
+
 		auto & value = gen->get_handle().promise().value_;
 
 		// ignore members, that are waiting for an object
-		if( value.wait_for_object && !value.wait_for_object->condition_reached() ) {
+		if( !value.ready( tp ) ) {
 			//tasks_to_schedule_next.push_back( gen );
 			continue;
 		}
 
+		// timer coalescing: tasks, that are still within their slack,
+		// only run together with tasks, that have to run now.
+		// Waiting tasks are sorted to the front, so they are resumed first.
+		if( value.wakeup_reason == YIELD::WakeupReason::TIME && !deadline_reached && !resumed ) {
+			continue;
+		}
+
+
+		// the next co_yield overwrites the value
+		TaskStats stats = value.stats;
+		CancelToken *cancel_token = value.cancel_token;
+		SpawnedTask *spawned = value.spawned;
+		TaskFailure failure;
+		TaskRun run;
+
+		if( tracer ) {
+			run.task = gen;
+			run.wakeup_reason = value.wakeup_reason;
+			run.waited_for = value.wait_for_object;
+		}
+
+		// only the resume itself, not the checks of the skipped tasks
+		// or the removal of the previous one
+		const auto resume_start = std::chrono::steady_clock::now();
 
+		// the same monitor for begin() and end()
+		RunningTask *monitor = running_task.load( std::memory_order_acquire );
+
+		if( monitor ) {
+			monitor->begin( gen, resume_start.time_since_epoch(), value.expected_duration, stats.resumes, tasks.size() );
+		}
+
+#if __cpp_exceptions
+		try {
+			(*gen)();
+		} catch( ... ) {
+			if( !isolate_faults ) {
+				if( monitor ) {
+					monitor->end();
+				}
+
+				throw;
+			}
+
+			failure.exception = std::current_exception();
+		}
+#else
 		(*gen)();
+#endif
+		resumed = true;
+
+		if( monitor ) {
+			monitor->end();
+		}
+
+		const auto resume_end = std::chrono::steady_clock::now();
+		const auto runtime = resume_end - resume_start;
+		stats.add( runtime );
+		busy_time += runtime;
+
+		if( tracer ) {
+			const auto now = YIELD::clock::now();
+
+			run.start = resume_start;
+			run.end = resume_end;
+			run.finished = gen->finished();
+			run.waits_for = run.finished ? nullptr : value.wait_for_object;
+			run.next_run_in = value.next_run > now ? value.next_run - now : std::chrono::nanoseconds( 0 );
+			tracer->task_ran( run );
+		}
+
+		if( gen->finished() ) {
+			failure.error = gen->error();
+
+			if( failure ) {
+				on_task_failed( *gen, failure );
+			}
 
-		if( gen->get_handle().done() ) {
 			remove_task( gen );
+		} else {
+			value.stats = stats;
+			value.cancel_token = cancel_token;
+			value.spawned = spawned;
 		}
 	}
 
-	return true;
+	// if only tasks waiting for an object have been found,
+	// the scheduler can go idle. Objects changed by an event, that
+	// calls wakeup(), interrupt idle(), all others are checked again
+	// after Conf::MAX_IDLE at the latest.
+	return resumed;
 }
 
 } // namespace CoScheduler
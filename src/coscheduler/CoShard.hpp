@@ -0,0 +1,466 @@
+/**
+ * One scheduler per cpu core (linux only)
+ * @author Copyright (c) 2024 Martin Oberzalek
+ */
+#pragma once
+#ifndef SRC_COSCHEDULER_COSHARD_HPP_
+#define SRC_COSCHEDULER_COSHARD_HPP_
+
+#include <pthread.h>
+#include <sched.h>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <latch>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "CoScheduler.hpp"
+#include "CoInbox.hpp"
+
+namespace CoScheduler {
+
+/**
+ * Share of one core, a task needs, estimated from its average
+ * runtime and the interval it requested in the last co_yield.
+ * Tasks, that want to run again immediately, count as 1.0.
+ */
+inline double task_utilization( const YIELD & value )
+{
+	const auto interval = value.next_run - value.last_run;
+	const auto runtime = value.stats.average();
+
+	if( interval <= runtime ) {
+		return 1.0;
+	}
+
+	return static_cast<double>( runtime.count() ) /
+		   static_cast<double>( std::chrono::duration_cast<std::chrono::nanoseconds>( interval ).count() );
+}
+
+/**
+ * Decides, which tasks a shard hands over to an other shard,
+ * see Shard::request_migration()
+ */
+class MigrationSelector
+{
+public:
+	virtual ~MigrationSelector() {}
+
+	/**
+	 * value is the state of the suspended task,
+	 * remaining is the utilization, that still should be moved
+	 */
+	virtual bool select( const YIELD & value, double remaining ) const = 0;
+};
+
+/**
+ * Scheduler, that runs in its own thread, pinned to one cpu core.
+ *
+ * Tasks are not created by the caller, but by a factory, which is
+ * called in the thread of the shard. So the coroutine frame is
+ * allocated and first touched by the pinned thread, and the memory
+ * stays local to the core (and to the NUMA node).
+ * The shard owns these tasks (see Scheduler::spawn()) and frees
+ * them, when they are finished.
+ *
+ * Shards are created by a ShardGroup, the shard object itself
+ * lives on the stack of its thread.
+ */
+template<class Conf> class Shard : public Scheduler<Conf>
+{
+public:
+	using yield_type = Scheduler<Conf>::yield_type;
+	using factory_t = std::function<yield_type()>;
+
+private:
+	struct MigrationOrder
+	{
+		Shard *target = nullptr;
+		double utilization = 0;
+		const MigrationSelector *selector = nullptr;
+	};
+
+	static constexpr std::size_t MAX_MIGRATION_ORDERS = 4;
+
+	const unsigned id;
+	const int cpu;
+	Inbox<factory_t*,Conf::MAX_REMOTE_TASKS> factories;
+	Inbox<yield_type*,Conf::MAX_REMOTE_TASKS> migrated_tasks;
+	Inbox<MigrationOrder,MAX_MIGRATION_ORDERS> migration_orders;
+
+	// written by the shard thread only, read by the balancer
+	alignas(64) std::atomic<std::uint64_t> busy_ns = 0;
+	std::atomic<std::size_t> task_count = 0;
+
+	static inline thread_local Shard *current_shard = nullptr;
+
+public:
+	Shard( unsigned id_, int cpu_ )
+	: id( id_ ),
+	  cpu( cpu_ )
+	{
+		current_shard = this;
+	}
+
+	~Shard()
+	{
+		factory_t *factory = nullptr;
+
+		while( factories.pop( factory ) ) {
+			delete factory;
+		}
+
+		yield_type *task = nullptr;
+
+		while( migrated_tasks.pop( task ) ) {
+			delete task;
+		}
+
+		current_shard = nullptr;
+	}
+
+	Shard( const Shard & other ) = delete;
+	Shard & operator=( const Shard & other ) = delete;
+
+	/**
+	 * the shard of the calling thread, or nullptr
+	 */
+	static Shard * current() {
+		return current_shard;
+	}
+
+	unsigned get_id() const {
+		return id;
+	}
+
+	int get_cpu() const {
+		return cpu;
+	}
+
+	// spawn( yield_type && task ) from the shard thread
+	using Scheduler<Conf>::spawn;
+
+	/**
+	 * Creates a task in this shard, can be called from any thread.
+	 * The factory is called at the start of the next schedule() run.
+	 * Returns false, if the inbox is full.
+	 */
+	bool spawn( factory_t factory )
+	{
+		factory_t *f = new factory_t( std::move( factory ) );
+
+		if( !factories.push( f ) ) {
+			delete f;
+			return false;
+		}
+
+		this->wakeup();
+		return true;
+	}
+
+	/**
+	 * Hands over tasks with a total utilization of about the given
+	 * share of a core to target, see task_utilization().
+	 * Can be called from any thread, the tasks are moved at the start
+	 * of the next schedule() run, while all of them are suspended.
+	 * Only tasks created by spawn(), that are not waiting for an object,
+	 * are moved. Their next_run and their stats are kept, the frame
+	 * stays in the memory of this shard.
+	 * The selector has to stay valid, till the order has been processed.
+	 * Returns false, if there are too many pending orders.
+	 */
+	bool request_migration( Shard & target, double utilization, const MigrationSelector & selector )
+	{
+		if( !migration_orders.push( MigrationOrder{ &target, utilization, &selector } ) ) {
+			return false;
+		}
+
+		this->wakeup();
+		return true;
+	}
+
+	/**
+	 * total time spent in resuming tasks
+	 */
+	std::chrono::nanoseconds get_busy_time() const {
+		return std::chrono::nanoseconds( busy_ns.load( std::memory_order_relaxed ) );
+	}
+
+	std::size_t get_task_count() const {
+		return task_count.load( std::memory_order_relaxed );
+	}
+
+	bool schedule() override
+	{
+		fetch_factories();
+		fetch_migrated_tasks();
+		process_migration_orders();
+
+		const bool resumed = Scheduler<Conf>::schedule();
+
+		busy_ns.store( this->busy_time.count(), std::memory_order_relaxed );
+
+		task_count.store( this->tasks.size(), std::memory_order_relaxed );
+
+		return resumed;
+	}
+
+protected:
+	void fetch_migrated_tasks()
+	{
+		yield_type *task = nullptr;
+
+		while( migrated_tasks.pop( task ) ) {
+			this->spawn( std::move( *task ) );
+			delete task;
+		}
+	}
+
+	void process_migration_orders()
+	{
+		MigrationOrder order;
+
+		while( migration_orders.pop( order ) ) {
+
+			if( order.target == this ) {
+				continue;
+			}
+
+			double remaining = order.utilization;
+
+			for( SpawnedTask *node = this->spawned_tasks; node && remaining > 0; ) {
+
+				yield_type & owned = static_cast<typename Scheduler<Conf>::OwnedTask*>( node )->task;
+				const YIELD & value = owned.get_handle().promise().value_;
+
+				node = node->next;
+
+				// waitable objects may belong to this shard, eg. a RemoteEvent
+				if( owned.get_handle().done() ||
+					value.wait_for_object ||
+					!order.selector->select( value, remaining ) ) {
+					continue;
+				}
+
+				const double utilization = task_utilization( value );
+				yield_type *task = new yield_type( this->release( &owned ) );
+
+				if( !order.target->migrated_tasks.push( task ) ) {
+					// target inbox full, keep the task
+					this->spawn( std::move( *task ) );
+					delete task;
+					break;
+				}
+
+				remaining -= utilization;
+			}
+
+			order.target->wakeup();
+		}
+	}
+
+	void fetch_factories()
+	{
+		factory_t *factory = nullptr;
+
+		while( factories.pop( factory ) ) {
+			this->spawn( (*factory)() );
+			delete factory;
+		}
+	}
+};
+
+/**
+ * Event for waking up a coroutine in an other shard.
+ *
+ * The event has to belong to the shard of the waiting coroutine.
+ * set() can be called from any other shard. It writes the flag
+ * and wakes up the target via Scheduler::wakeup().
+ *
+ * With IdleWaiter as Conf::IDLE_WAITER the wakeup locks the mutex of the
+ * target's waiter, but only for the first notification, while the target
+ * is running, the following ones are collapsed. Reactor and IoUring
+ * notify via an eventfd, so set() takes no lock at all with them.
+ *
+ *   // in the coroutine on shard 7
+ *   CoScheduler::RemoteEvent<Shard> event( *Shard::current() );
+ *   co_yield YIELD( event );
+ *   event.reset();
+ *
+ *   // on shard 3
+ *   event.set();
+ */
+template<class SchedulerType> class RemoteEvent : public WaitForBase
+{
+	SchedulerType & target;
+	alignas(64) std::atomic<bool> flag = false;
+
+public:
+	RemoteEvent( SchedulerType & target_ )
+	: target( target_ )
+	{}
+
+	RemoteEvent( const RemoteEvent & other ) = delete;
+	RemoteEvent & operator=( const RemoteEvent & other ) = delete;
+
+	void set()
+	{
+		flag.store( true, std::memory_order_release );
+		target.wakeup();
+	}
+
+	void reset() {
+		flag.store( false, std::memory_order_relaxed );
+	}
+
+	bool condition_reached() const override {
+		return flag.load( std::memory_order_acquire );
+	}
+};
+
+/**
+ * Starts one shard per cpu core.
+ *
+ *   CoScheduler::ShardGroup<DynamicConf> shards;
+ *
+ *   shards.spawn( 3, []() { return my_task<Scheduler::yield_type>(); } );
+ *   ...
+ *   shards.stop();
+ *
+ * Each thread pins itself to its core, before the shard is
+ * constructed. So the containers of the scheduler are allocated
+ * in local memory too.
+ *
+ * The shards are running, as soon as the constructor returns.
+ * Exceptions thrown by the tasks are not caught and terminate the
+ * program.
+ */
+template<class Conf> class ShardGroup
+{
+public:
+	using shard_type = Shard<Conf>;
+	using factory_t = shard_type::factory_t;
+
+private:
+	std::vector<shard_type*> shards;
+	std::vector<std::thread> threads;
+	std::latch started;
+	std::latch finished;
+
+public:
+	/**
+	 * count shards, pinned to the first count cpus,
+	 * that the process is allowed to run on
+	 */
+	ShardGroup( unsigned count = std::thread::hardware_concurrency() )
+	: ShardGroup( allowed_cpus( count ) )
+	{}
+
+	ShardGroup( const std::vector<int> & cpus )
+	: shards( cpus.size(), nullptr ),
+	  started( cpus.size() ),
+	  finished( cpus.size() )
+	{
+		threads.reserve( cpus.size() );
+
+		for( unsigned i = 0; i < cpus.size(); i++ ) {
+			threads.emplace_back( [this,i,cpu=cpus[i]]() {
+				run( i, cpu );
+			});
+		}
+
+		started.wait();
+	}
+
+	~ShardGroup()
+	{
+		stop();
+	}
+
+	ShardGroup( const ShardGroup & other ) = delete;
+	ShardGroup & operator=( const ShardGroup & other ) = delete;
+
+	std::size_t size() const {
+		return shards.size();
+	}
+
+	shard_type & get_shard( unsigned idx ) {
+		return *shards.at( idx );
+	}
+
+	/**
+	 * see Shard::spawn(), must not be called after stop()
+	 */
+	bool spawn( unsigned idx, factory_t factory ) {
+		return get_shard( idx ).spawn( std::move( factory ) );
+	}
+
+	/**
+	 * stops all shards and waits for the threads.
+	 * Unfinished tasks are destroyed.
+	 */
+	void stop()
+	{
+		if( threads.empty() ) {
+			return;
+		}
+
+		for( shard_type *shard : shards ) {
+			shard->stop();
+		}
+
+		for( std::thread & thread : threads ) {
+			thread.join();
+		}
+
+		threads.clear();
+	}
+
+private:
+	void run( unsigned idx, int cpu )
+	{
+		cpu_set_t set;
+		CPU_ZERO( &set );
+		CPU_SET( cpu, &set );
+
+		// if the cpu is not available, the thread just runs unpinned
+		pthread_setaffinity_np( pthread_self(), sizeof(set), &set );
+
+		shard_type shard( idx, cpu );
+		shards[idx] = &shard;
+		started.count_down();
+
+		shard.infinite_schedule();
+
+		// other shards may still send events to this one
+		finished.arrive_and_wait();
+	}
+
+	static std::vector<int> allowed_cpus( unsigned count )
+	{
+		std::vector<int> cpus;
+		cpu_set_t set;
+		CPU_ZERO( &set );
+
+		if( sched_getaffinity( 0, sizeof(set), &set ) == 0 ) {
+			for( int cpu = 0; cpu < CPU_SETSIZE && cpus.size() < count; cpu++ ) {
+				if( CPU_ISSET( cpu, &set ) ) {
+					cpus.push_back( cpu );
+				}
+			}
+		}
+
+		for( int cpu = 0; cpus.size() < count; cpu++ ) {
+			cpus.push_back( cpu );
+		}
+
+		return cpus;
+	}
+};
+
+} // namespace CoScheduler
+
+#endif /* SRC_COSCHEDULER_COSHARD_HPP_ */
@@ -0,0 +1,143 @@
+/**
+ * Waiting for unix signals via signalfd (linux only)
+ * @author Copyright (c) 2024 Martin Oberzalek
+ */
+#pragma once
+#ifndef SRC_COSCHEDULER_COSIGNAL_HPP_
+#define SRC_COSCHEDULER_COSIGNAL_HPP_
+
+#include <sys/signalfd.h>
+#include <signal.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdint>
+#include <initializer_list>
+#include <system_error>
+#include "CoScheduler.hpp"
+#include "CoReactor.hpp"
+
+namespace CoScheduler {
+
+/**
+ * Receives signals as normal events on the reactor,
+ * so they can be handled in a coroutine, instead of a signal handler.
+ *
+ *   CoScheduler::SignalWaiter signals( sch.get_idle_waiter(), { SIGTERM, SIGINT } );
+ *
+ *   co_yield YIELD( signals );
+ *   int sig = signals.pop_signal();
+ *   sch.stop();
+ *
+ * The signals are blocked for the calling thread. Create the
+ * SignalWaiter before starting other threads, so they inherit
+ * the signal mask, otherwise the signal may be delivered to one
+ * of them the normal way.
+ *
+ * Like normal signals, multiple deliveries of the same signal,
+ * which have not been fetched yet, are collapsed into one.
+ *
+ * The destructor unblocks the signals again, which were not blocked
+ * before, so destroy the SignalWaiter in the thread, that created it.
+ */
+class SignalWaiter : public WaitForBase, public Reactor::Handler
+{
+	Reactor & reactor;
+	int fd = -1;
+	std::uint64_t pending = 0;
+
+	// signals, that have been blocked by this object
+	sigset_t blocked;
+
+public:
+	SignalWaiter( Reactor & reactor_, std::initializer_list<int> signals )
+	: reactor( reactor_ )
+	{
+		sigset_t mask;
+		sigemptyset( &mask );
+
+		for( int sig : signals ) {
+			sigaddset( &mask, sig );
+		}
+
+		sigset_t old_mask;
+		pthread_sigmask( SIG_BLOCK, &mask, &old_mask );
+
+		sigemptyset( &blocked );
+
+		for( int sig : signals ) {
+			if( !sigismember( &old_mask, sig ) ) {
+				sigaddset( &blocked, sig );
+			}
+		}
+
+		fd = signalfd( -1, &mask, SFD_NONBLOCK | SFD_CLOEXEC );
+
+		if( fd < 0 ) {
+			const int err = errno;
+			pthread_sigmask( SIG_UNBLOCK, &blocked, nullptr );
+			throw std::system_error( err, std::generic_category(), "signalfd" );
+		}
+
+		const int err = reactor.add( fd, EPOLLIN, *this );
+
+		if( err < 0 ) {
+			close( fd );
+			pthread_sigmask( SIG_UNBLOCK, &blocked, nullptr );
+			throw std::system_error( -err, std::generic_category(), "epoll_ctl" );
+		}
+	}
+
+	/**
+	 * Signals, that are still pending, are fetched and dropped,
+	 * before the signals are unblocked.
+	 */
+	~SignalWaiter()
+	{
+		reactor.remove( fd );
+		on_event( EPOLLIN );
+		close( fd );
+
+		pthread_sigmask( SIG_UNBLOCK, &blocked, nullptr );
+	}
+
+	SignalWaiter( const SignalWaiter & other ) = delete;
+	SignalWaiter & operator=( const SignalWaiter & other ) = delete;
+
+	bool condition_reached() const override {
+		return pending != 0;
+	}
+
+	/**
+	 * returns the lowest received signal number, or 0
+	 */
+	int pop_signal()
+	{
+		for( int sig = 1; sig <= 64; sig++ ) {
+			const std::uint64_t bit = std::uint64_t(1) << ( sig - 1 );
+
+			if( pending & bit ) {
+				pending &= ~bit;
+				return sig;
+			}
+		}
+
+		return 0;
+	}
+
+	void on_event( std::uint32_t ) override
+	{
+		signalfd_siginfo info;
+
+		// edge triggered, so read until EAGAIN
+		while( read( fd, &info, sizeof(info) ) == sizeof(info) ) {
+			// signal numbers start at 1, SIGRTMAX is 64 on linux
+			if( info.ssi_signo >= 1 && info.ssi_signo <= 64 ) {
+				pending |= std::uint64_t(1) << ( info.ssi_signo - 1 );
+			}
+		}
+	}
+};
+
+} // namespace CoScheduler
+
+#endif /* SRC_COSCHEDULER_COSIGNAL_HPP_ */
@@ -0,0 +1,253 @@
+/**
+ * Restarting of failed tasks
+ * @author Copyright (c) 2024 Martin Oberzalek
+ */
+#pragma once
+#ifndef SRC_COSCHEDULER_COSUPERVISOR_HPP_
+#define SRC_COSCHEDULER_COSUPERVISOR_HPP_
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <list>
+#include <optional>
+#include <string>
+#include <utility>
+#include <format.h>
+#include <OutDebug.h>
+#include "CoScheduler.hpp"
+
+namespace CoScheduler {
+
+struct RestartPolicy
+{
+	// after that many restarts in a row, the task is parked
+	unsigned max_restarts = 5;
+
+	// the delay before a restart is doubled after each failure
+	std::chrono::nanoseconds initial_backoff = std::chrono::milliseconds( 100 );
+	std::chrono::nanoseconds max_backoff = std::chrono::seconds( 10 );
+
+	// a task, that ran that long before it failed, starts with
+	// the initial backoff and max_restarts again
+	std::chrono::nanoseconds reset_after = std::chrono::seconds( 60 );
+};
+
+/**
+ * Runs tasks created by a factory and restarts them, if they fail
+ * with an exception or an error code (ErrorModel::ERROR_CODES).
+ *
+ *   CoScheduler::Supervisor<Scheduler> supervisor( sch );
+ *
+ *   supervisor.supervise( "modbus", []() {
+ *     return modbus_poll<Scheduler::yield_type>();
+ *   });
+ *
+ *   sch.infinite_schedule();
+ *
+ * The failure is logged and the task is recreated after a backoff,
+ * so a task, that fails immediately again, can't keep the scheduler busy.
+ * After RestartPolicy::max_restarts the task is parked, it can be
+ * started again with restart().
+ *
+ * The supervised tasks run as sub coroutines, so their exceptions never
+ * reach schedule(). For tasks without a factory see Scheduler::set_fault_isolation().
+ * The supervisor has to live longer than the scheduler runs, remaining tasks
+ * are destroyed with the supervisor.
+ */
+template<class SchedulerType> class Supervisor
+{
+public:
+	using yield_type = SchedulerType::yield_type;
+	using factory_t = std::function<yield_type()>;
+
+	enum class State
+	{
+		RUNNING,
+		BACKOFF,
+		PARKED,
+		FINISHED
+	};
+
+	class Child
+	{
+		friend class Supervisor;
+
+		const std::string name;
+		const factory_t factory;
+		const RestartPolicy policy;
+		State state = State::RUNNING;
+		unsigned restarts = 0;
+		unsigned failures = 0;
+		TaskFailure last_failure;
+		std::optional<yield_type> runner;
+
+	public:
+		Child( std::string name_, factory_t factory_, const RestartPolicy & policy_ )
+		: name( std::move( name_ ) ),
+		  factory( std::move( factory_ ) ),
+		  policy( policy_ )
+		{}
+
+		const std::string & get_name() const {
+			return name;
+		}
+
+		State get_state() const {
+			return state;
+		}
+
+		// restarts since the last stable run
+		unsigned get_restarts() const {
+			return restarts;
+		}
+
+		unsigned get_failures() const {
+			return failures;
+		}
+
+		const TaskFailure & get_last_failure() const {
+			return last_failure;
+		}
+	};
+
+private:
+	SchedulerType & scheduler;
+
+	// stable addresses, the runners keep references
+	std::list<Child> children;
+
+public:
+	Supervisor( SchedulerType & scheduler_ )
+	: scheduler( scheduler_ )
+	{}
+
+	virtual ~Supervisor()
+	{
+		for( Child & child : children ) {
+			if( child.runner && child.runner->get_handle() ) {
+				scheduler.remove_task_reference( *child.runner );
+			}
+		}
+	}
+
+	Supervisor( const Supervisor & other ) = delete;
+	Supervisor & operator=( const Supervisor & other ) = delete;
+
+	Child & supervise( std::string name, factory_t factory, const RestartPolicy & policy = {} )
+	{
+		Child & child = children.emplace_back( std::move( name ), std::move( factory ), policy );
+		start( child );
+		return child;
+	}
+
+	/**
+	 * starts a parked or finished task again
+	 */
+	bool restart( Child & child )
+	{
+		if( child.state != State::PARKED && child.state != State::FINISHED ) {
+			return false;
+		}
+
+		child.restarts = 0;
+		start( child );
+		return true;
+	}
+
+	const std::list<Child> & get_children() const {
+		return children;
+	}
+
+	static std::string describe( const TaskFailure & failure ) {
+		return failure.describe();
+	}
+
+protected:
+	/**
+	 * called after each failure, the state of the child
+	 * tells, if it is restarted after backoff, or parked
+	 */
+	virtual void log_failure( const Child & child, const TaskFailure & failure, std::chrono::nanoseconds backoff )
+	{
+		if( child.state == State::PARKED ) {
+			CPPDEBUG( Tools::format( "task %s failed: %s, parked after %d restarts",
+									 child.name, describe( failure ), child.restarts ) );
+		} else {
+			CPPDEBUG( Tools::format( "task %s failed: %s, restart in %dms",
+									 child.name, describe( failure ),
+									 std::chrono::duration_cast<std::chrono::milliseconds>( backoff ).count() ) );
+		}
+	}
+
+private:
+	void start( Child & child )
+	{
+		child.state = State::RUNNING;
+		child.runner.emplace( run( child ) );
+		scheduler.add_task_reference( *child.runner );
+	}
+
+	yield_type run( Child & child )
+	{
+		auto backoff = child.policy.initial_backoff;
+
+		while( true ) {
+			child.state = State::RUNNING;
+
+			const auto started = YIELD::clock::now();
+			TaskFailure failure;
+
+			{
+				yield_type task = child.factory();
+
+#if __cpp_exceptions
+				try {
+#endif
+					while( task ) {
+						const YIELD & result = co_yield task();
+						task.get_handle().promise().value_.wakeup_reason = result.wakeup_reason;
+					}
+#if __cpp_exceptions
+				} catch( ... ) {
+					failure.exception = std::current_exception();
+				}
+#endif
+
+				failure.error = task.error();
+			}
+
+			if( !failure ) {
+				child.state = State::FINISHED;
+				co_return;
+			}
+
+			child.failures++;
+			child.last_failure = failure;
+
+			if( YIELD::clock::now() - started >= child.policy.reset_after ) {
+				child.restarts = 0;
+				backoff = child.policy.initial_backoff;
+			}
+
+			if( child.restarts >= child.policy.max_restarts ) {
+				child.state = State::PARKED;
+				log_failure( child, failure, backoff );
+				co_return;
+			}
+
+			child.state = State::BACKOFF;
+			log_failure( child, failure, backoff );
+
+			co_yield YIELD( backoff );
+
+			child.restarts++;
+			backoff = std::min( backoff * 2, child.policy.max_backoff );
+		}
+	}
+};
+
+} // namespace CoScheduler
+
+#endif /* SRC_COSCHEDULER_COSUPERVISOR_HPP_ */
@@ -0,0 +1,229 @@
+/**
+ * Structured concurrency: child tasks bound to a scope
+ * @author Copyright (c) 2024 Martin Oberzalek
+ */
+#pragma once
+#ifndef SRC_COSCHEDULER_COTASKSCOPE_HPP_
+#define SRC_COSCHEDULER_COTASKSCOPE_HPP_
+
+#include <cstddef>
+#include <exception>
+#include <new>
+#include <system_error>
+#include <utility>
+#include "CoScheduler.hpp"
+#include "CoFramePool.hpp"
+
+namespace CoScheduler {
+
+/**
+ * Nursery for child tasks. The children can't outlive the scope:
+ *
+ *   CoScheduler::TaskScope<Scheduler> scope( sch );
+ *
+ *   for( auto & conn : connections ) {
+ *     scope.spawn( [&conn]() {
+ *       return handle_request<Scheduler::yield_type>( conn );
+ *     });
+ *   }
+ *
+ *   co_yield YIELD( scope.join() );
+ *   scope.rethrow_if_failed();
+ *
+ * If a child throws, or fails with an error code (ErrorModel::ERROR_CODES),
+ * the error is stored and all other children are cancelled (see CancelToken).
+ * join() gets ready, when all children are finished.
+ *
+ * The frames of the children are allocated from an arena of the scope.
+ * The arena is reused, when a child is spawned after all previous
+ * children have finished, and released at once, when the scope is
+ * destroyed. So the memory is bound by the children running at the
+ * same time. The factory should only create the coroutine.
+ *
+ * If the scope is destroyed before all children are finished, eg. because
+ * the parent got destroyed, the remaining children are destroyed too.
+ */
+template<class SchedulerType> class TaskScope : public WaitForBase
+{
+public:
+	using yield_type = SchedulerType::yield_type;
+
+private:
+	struct Child
+	{
+		yield_type task;
+		Child *next;
+	};
+
+	SchedulerType & scheduler;
+	CancelToken token;
+	// destroyed after the children
+	FrameArena arena;
+	Child *children = nullptr;
+	std::size_t live = 0;
+#if __cpp_exceptions
+	std::exception_ptr error;
+#endif
+	std::error_code error_code;
+
+public:
+	/**
+	 * if parent is cancelled, all children are cancelled too
+	 */
+	TaskScope( SchedulerType & scheduler_,
+			   const CancelToken *parent = nullptr,
+			   std::size_t arena_chunk_size = 16 * 1024 )
+	: scheduler( scheduler_ ),
+	  token( parent ),
+	  arena( arena_chunk_size )
+	{}
+
+	~TaskScope()
+	{
+		release_children();
+	}
+
+	TaskScope( const TaskScope & other ) = delete;
+	TaskScope & operator=( const TaskScope & other ) = delete;
+
+	template<class Factory> void spawn( Factory factory )
+	{
+		if( live == 0 && all_frames_destroyed() ) {
+			release_children();
+			arena.reset();
+		}
+
+		Child *child = nullptr;
+
+		{
+			// only the frames of the child come from the arena
+			FrameArenaScope use_arena( arena );
+			child = new (arena.allocate( sizeof(Child) )) Child{ run_child( factory() ), children };
+		}
+
+		children = child;
+		live++;
+
+		scheduler.add_task_reference( child->task, token );
+	}
+
+	/**
+	 * ready, when all children are finished
+	 */
+	WaitForBase & join() {
+		return *this;
+	}
+
+	bool condition_reached() const override {
+		return live == 0;
+	}
+
+	void cancel() {
+		token.cancel();
+	}
+
+	CancelToken & get_cancel_token() {
+		return token;
+	}
+
+	bool failed() const {
+#if __cpp_exceptions
+		if( error ) {
+			return true;
+		}
+#endif
+		return static_cast<bool>( error_code );
+	}
+
+	/**
+	 * the first error code, a child failed with
+	 */
+	std::error_code get_error_code() const {
+		return error_code;
+	}
+
+#if __cpp_exceptions
+	/**
+	 * the first exception thrown by a child
+	 */
+	std::exception_ptr get_error() const {
+		return error;
+	}
+
+	void rethrow_if_failed() const
+	{
+		if( error ) {
+			std::rethrow_exception( error );
+		}
+	}
+#endif
+
+private:
+	/**
+	 * finished tasks have been reset by the scheduler
+	 */
+	bool all_frames_destroyed() const
+	{
+		for( Child *child = children; child; child = child->next ) {
+			if( child->task.get_handle() ) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void release_children()
+	{
+		while( children ) {
+			Child *child = children;
+			children = child->next;
+
+			if( child->task.get_handle() ) {
+				scheduler.remove_task_reference( child->task );
+			}
+
+			child->~Child();
+		}
+	}
+
+	/**
+	 * Runs the child as sub coroutine, so its exceptions can be
+	 * caught here, instead of being thrown out of schedule().
+	 * The wakeup reason is passed on to the child, so it sees,
+	 * when it has been cancelled.
+	 */
+	yield_type run_child( yield_type child )
+	{
+#if __cpp_exceptions
+		try {
+#endif
+			while( child ) {
+				const YIELD & result = co_yield child();
+				child.get_handle().promise().value_.wakeup_reason = result.wakeup_reason;
+			}
+#if __cpp_exceptions
+		} catch( ... ) {
+			if( !failed() ) {
+				error = std::current_exception();
+			}
+
+			token.cancel();
+		}
+#endif
+
+		if( child.error() ) {
+			if( !failed() ) {
+				error_code = child.error();
+			}
+
+			token.cancel();
+		}
+
+		live--;
+	}
+};
+
+} // namespace CoScheduler
+
+#endif /* SRC_COSCHEDULER_COTASKSCOPE_HPP_ */
@@ -0,0 +1,457 @@
+/**
+ * Worker threads for blocking calls
+ * @author Copyright (c) 2024 Martin Oberzalek
+ */
+#pragma once
+#ifndef SRC_COSCHEDULER_COTHREADPOOL_HPP_
+#define SRC_COSCHEDULER_COTHREADPOOL_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "CoScheduler.hpp"
+
+namespace CoScheduler {
+
+class ThreadPool;
+
+/**
+ * A job, that is queued in the ThreadPool.
+ * The job is shared by the PoolJob, that waits for it, and the pool,
+ * each of them holds a reference. So the PoolJob can be destroyed,
+ * while a worker still runs the job, the result is discarded then.
+ */
+class PoolJobBase
+{
+	friend class ThreadPool;
+
+protected:
+	enum class State
+	{
+		QUEUED,
+		RUNNING,
+		DONE
+	};
+
+	enum class Home
+	{
+		ATTACHED,
+		WAKING,
+		DETACHED
+	};
+
+	std::atomic<State> state = State::QUEUED;
+	bool dropped = false;
+	PoolJobBase *prev = nullptr;
+	PoolJobBase *next = nullptr;
+
+	// one of the PoolJob, one of the pool
+	std::atomic<unsigned> references = 2;
+
+	// wakes up the home scheduler, as long as the PoolJob exists
+	std::atomic<Home> home = Home::ATTACHED;
+	void (*wake)( void *scheduler ) = nullptr;
+	void *scheduler = nullptr;
+
+public:
+	virtual ~PoolJobBase() {}
+
+	bool done() const {
+		return state.load( std::memory_order_acquire ) == State::DONE;
+	}
+
+	/**
+	 * the pool has been destroyed, before the job was started
+	 */
+	bool was_dropped() const {
+		return done() && dropped;
+	}
+
+	void release()
+	{
+		if( references.fetch_sub( 1, std::memory_order_acq_rel ) == 1 ) {
+			delete this;
+		}
+	}
+
+	/**
+	 * The home scheduler is not woken up anymore. If the worker
+	 * is just waking it up, this waits for the notification only.
+	 */
+	void detach()
+	{
+		Home expected = Home::ATTACHED;
+
+		while( !home.compare_exchange_weak( expected, Home::DETACHED, std::memory_order_acq_rel ) ) {
+			if( expected == Home::DETACHED ) {
+				return;
+			}
+
+			expected = Home::ATTACHED;
+		}
+	}
+
+protected:
+	virtual void run() = 0;
+
+	/**
+	 * called instead of run(), if the pool is destroyed,
+	 * before the job has been started
+	 */
+	virtual void drop() {
+		dropped = true;
+	}
+
+	void notify_home()
+	{
+		Home expected = Home::ATTACHED;
+
+		if( !home.compare_exchange_strong( expected, Home::WAKING, std::memory_order_acq_rel ) ) {
+			return;
+		}
+
+		wake( scheduler );
+
+		home.store( Home::ATTACHED, std::memory_order_release );
+	}
+};
+
+/**
+ * A fixed number of threads, executing blocking calls, like
+ * compression or hashing of big files, so the scheduler
+ * thread is not blocked. See run_on_pool().
+ *
+ * A finished job wakes up its home scheduler with wakeup(). With the
+ * IdleWaiter this locks the mutex of the waiter for the first job,
+ * that finishes while the scheduler idles, the Reactor and the
+ * IoUring are notified through their eventfd.
+ */
+class ThreadPool
+{
+	std::mutex m;
+	std::condition_variable cond;
+	PoolJobBase *first = nullptr;
+	PoolJobBase *last = nullptr;
+	bool stopping = false;
+	std::vector<std::thread> threads;
+
+public:
+	ThreadPool( unsigned count = std::thread::hardware_concurrency() )
+	{
+		if( count == 0 ) {
+			count = 1;
+		}
+
+		threads.reserve( count );
+
+		for( unsigned i = 0; i < count; i++ ) {
+			threads.emplace_back( [this]() {
+				work();
+			});
+		}
+	}
+
+	/**
+	 * Running jobs are finished. Jobs, that have not been started yet,
+	 * are done without running them, get() of their PoolJob throws
+	 * std::future_error with std::future_errc::broken_promise.
+	 * Their home schedulers are woken up, as usual.
+	 */
+	~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock( m );
+			stopping = true;
+		}
+
+		cond.notify_all();
+
+		for( std::thread & thread : threads ) {
+			thread.join();
+		}
+
+		while( true ) {
+			PoolJobBase *job = nullptr;
+
+			{
+				std::lock_guard<std::mutex> lock( m );
+
+				if( !first ) {
+					break;
+				}
+
+				job = first;
+				unlink( *job );
+				job->state.store( PoolJobBase::State::RUNNING, std::memory_order_relaxed );
+			}
+
+			job->drop();
+			job->state.store( PoolJobBase::State::DONE, std::memory_order_release );
+			job->notify_home();
+			job->release();
+		}
+	}
+
+	ThreadPool( const ThreadPool & other ) = delete;
+	ThreadPool & operator=( const ThreadPool & other ) = delete;
+
+	std::size_t size() const {
+		return threads.size();
+	}
+
+	void submit( PoolJobBase & job )
+	{
+		{
+			std::lock_guard<std::mutex> lock( m );
+
+			job.state.store( PoolJobBase::State::QUEUED, std::memory_order_relaxed );
+			job.next = nullptr;
+			job.prev = last;
+
+			if( last ) {
+				last->next = &job;
+			} else {
+				first = &job;
+			}
+
+			last = &job;
+		}
+
+		cond.notify_one();
+	}
+
+	/**
+	 * Removes the job from the queue, if it has not been started yet,
+	 * and drops the reference of the pool. A running job is not waited for.
+	 * Returns false, if the job is running, or done.
+	 */
+	bool cancel( PoolJobBase & job )
+	{
+		{
+			std::lock_guard<std::mutex> lock( m );
+
+			if( job.state.load( std::memory_order_relaxed ) != PoolJobBase::State::QUEUED ) {
+				return false;
+			}
+
+			unlink( job );
+			job.state.store( PoolJobBase::State::DONE, std::memory_order_release );
+		}
+
+		job.release();
+		return true;
+	}
+
+private:
+	void unlink( PoolJobBase & job )
+	{
+		if( job.prev ) {
+			job.prev->next = job.next;
+		} else {
+			first = job.next;
+		}
+
+		if( job.next ) {
+			job.next->prev = job.prev;
+		} else {
+			last = job.prev;
+		}
+
+		job.prev = nullptr;
+		job.next = nullptr;
+	}
+
+	void work()
+	{
+		while( true ) {
+			PoolJobBase *job = nullptr;
+
+			{
+				std::unique_lock<std::mutex> lock( m );
+
+				cond.wait( lock, [this]() {
+					return stopping || first != nullptr;
+				});
+
+				if( stopping ) {
+					return;
+				}
+
+				job = first;
+				unlink( *job );
+				job->state.store( PoolJobBase::State::RUNNING, std::memory_order_relaxed );
+			}
+
+			job->run();
+			job->state.store( PoolJobBase::State::DONE, std::memory_order_release );
+
+			// notifications of the scheduler are collapsed, so multiple jobs,
+			// finishing while the scheduler is busy, cause only one wakeup
+			job->notify_home();
+			job->release();
+		}
+	}
+};
+
+/**
+ * Result of a callable, executed by the ThreadPool.
+ * Exceptions thrown by the callable are rethrown by get().
+ */
+template<class Fn> class PoolJob : public WaitForBase
+{
+public:
+	using result_type = std::invoke_result_t<Fn>;
+
+private:
+	using storage_type = std::conditional_t<std::is_void_v<result_type>, bool, result_type>;
+
+	class Job : public PoolJobBase
+	{
+	public:
+		Fn fn;
+		std::optional<storage_type> result;
+#if __cpp_exceptions
+		std::exception_ptr exception;
+#endif
+
+		Job( Fn fn_, void (*wake_)( void *scheduler ), void *scheduler_ )
+		: fn( std::move( fn_ ) )
+		{
+			wake = wake_;
+			scheduler = scheduler_;
+		}
+
+	protected:
+		void drop() override
+		{
+			PoolJobBase::drop();
+#if __cpp_exceptions
+			exception = std::make_exception_ptr( std::future_error( std::future_errc::broken_promise ) );
+#endif
+		}
+
+		void run() override
+		{
+#if __cpp_exceptions
+			try {
+				call();
+			} catch( ... ) {
+				exception = std::current_exception();
+			}
+#else
+			call();
+#endif
+		}
+
+	private:
+		void call()
+		{
+			if constexpr( std::is_void_v<result_type> ) {
+				fn();
+				result = true;
+			} else {
+				result.emplace( fn() );
+			}
+		}
+	};
+
+	ThreadPool & pool;
+	Job *job;
+
+public:
+	template<class SchedulerType>
+	PoolJob( ThreadPool & pool_, SchedulerType & home, Fn fn )
+	: pool( pool_ ),
+	  job( new Job( std::move( fn ),
+					[]( void *sch ) {
+						static_cast<SchedulerType*>( sch )->wakeup();
+					},
+					&home ) )
+	{
+		pool.submit( *job );
+	}
+
+	/**
+	 * A job, that has not been started yet, is removed from the queue.
+	 * A running job is not waited for, it is left to the worker,
+	 * which discards the result.
+	 * The pool may already be gone, if the job is done.
+	 */
+	~PoolJob()
+	{
+		if( !job->done() ) {
+			pool.cancel( *job );
+		}
+
+		job->detach();
+		job->release();
+	}
+
+	PoolJob( const PoolJob & other ) = delete;
+	PoolJob & operator=( const PoolJob & other ) = delete;
+
+	bool condition_reached() const override {
+		return job->done();
+	}
+
+	bool done() const {
+		return job->done();
+	}
+
+	/**
+	 * true, if the pool has been destroyed before the job was started
+	 */
+	bool was_dropped() const {
+		return job->was_dropped();
+	}
+
+	/**
+	 * only valid, when the job is done and has not been dropped
+	 */
+	result_type get()
+	{
+#if __cpp_exceptions
+		if( job->exception ) {
+			std::rethrow_exception( job->exception );
+		}
+#endif
+
+		if constexpr( !std::is_void_v<result_type> ) {
+			return std::move( *job->result );
+		}
+	}
+};
+
+/**
+ * Executes fn in the pool. The coroutine is resumed by its home
+ * scheduler, when fn has finished:
+ *
+ *   auto job = CoScheduler::run_on_pool( pool, sch, [file]() {
+ *     return compress( file );
+ *   });
+ *
+ *   co_yield YIELD( job );
+ *   auto compressed = job.get();
+ *
+ * The job object has to stay in the coroutine frame. If the coroutine
+ * is destroyed, a job that has not started yet is removed from the
+ * queue, a running job is finished by the worker in the background.
+ * So fn must not capture references to the coroutine frame, if the
+ * coroutine can be destroyed, while the job runs.
+ */
+template<class SchedulerType, class Fn>
+PoolJob<Fn> run_on_pool( ThreadPool & pool, SchedulerType & home, Fn fn )
+{
+	return PoolJob<Fn>( pool, home, std::move( fn ) );
+}
+
+} // namespace CoScheduler
+
+#endif /* SRC_COSCHEDULER_COTHREADPOOL_HPP_ */
@@ -0,0 +1,401 @@
+/**
+ * Binary trace log in a memory mapped ring file (linux only)
+ * @author Copyright (c) 2024 Martin Oberzalek
+ */
+#pragma once
+#ifndef SRC_COSCHEDULER_COTRACELOG_HPP_
+#define SRC_COSCHEDULER_COTRACELOG_HPP_
+
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <unordered_map>
+
+namespace CoScheduler {
+
+/**
+ * File layout, shared with the decoder tool:
+ *
+ *   TraceHeader
+ *   string table: TraceFormat entries, each followed by the file name and the format string
+ *   ring:         TraceRecord entries, each followed by the encoded arguments
+ *
+ * head and tail are positions, that are only growing,
+ * the offset within the ring is position % ring_size.
+ */
+namespace TraceFile {
+
+static constexpr char MAGIC[8] = { 'C', 'O', 'T', 'R', 'A', 'C', 'E', '1' };
+static constexpr std::uint32_t VERSION = 1;
+static constexpr std::uint32_t PADDING_ID = 0xFFFFFFFF;
+static constexpr std::uint32_t INVALID_ID = 0xFFFFFFFE;
+
+struct TraceHeader
+{
+	char          magic[8];
+	std::uint32_t version;
+	std::uint32_t format_count;
+	std::uint64_t string_table_size;
+	std::uint64_t string_table_used;
+	std::uint64_t ring_size;
+	std::uint64_t head;
+	std::uint64_t tail;
+};
+
+struct TraceFormat
+{
+	std::uint32_t line;
+	std::uint16_t file_len;
+	std::uint16_t fmt_len;
+};
+
+struct TraceRecord
+{
+	std::uint32_t size;			// including this header and padding, multiple of 8
+	std::uint32_t id;			// index of the format, or PADDING_ID
+	std::uint64_t timestamp;	// nanoseconds since epoch, system_clock
+};
+
+enum ArgType : std::uint8_t
+{
+	ARG_INT    = 'i',	// int64_t
+	ARG_UINT   = 'u',	// uint64_t
+	ARG_DOUBLE = 'f',	// double
+	ARG_STRING = 's',	// uint16_t length, followed by the chars
+	ARG_PTR    = 'p'	// uint64_t
+};
+
+inline constexpr std::uint64_t align8( std::uint64_t size ) {
+	return ( size + 7 ) & ~std::uint64_t(7);
+}
+
+inline constexpr std::uint64_t string_table_offset() {
+	return align8( sizeof(TraceHeader) );
+}
+
+inline constexpr std::uint64_t ring_offset( std::uint64_t string_table_size ) {
+	return string_table_offset() + align8( string_table_size );
+}
+
+} // namespace TraceFile
+
+/**
+ * call site of CO_TRACE
+ */
+struct TraceSite
+{
+	const char *file;
+	unsigned    line;
+	const char *fmt;
+};
+
+/**
+ * format id of a call site in the log, that was used last
+ * by this thread, see BinaryLog::format_id()
+ */
+struct TraceSiteCache
+{
+	std::uint64_t log_instance = 0;
+	std::uint32_t id = 0;
+};
+
+/**
+ * Binary log with deferred formatting.
+ *
+ * The hot path only writes the id of the format string, a timestamp and
+ * the raw arguments into a ring, that is mapped to a file. The file can
+ * be rendered later by the coscheduler_trace_decode tool, even after a crash.
+ *
+ * The format string and the source location are written into the
+ * string table of the file only once per call site and log:
+ *
+ *   CoScheduler::BinaryLog trace_log( "trace.bin" );
+ *
+ *   CO_TRACE( trace_log, "%s: count: %d", __FUNCTION__, i );
+ *
+ * Supported arguments are integers, floating point numbers, pointers and strings.
+ * Writing records has to be done by one thread only, usually the scheduler thread.
+ */
+class BinaryLog
+{
+	int fd = -1;
+	unsigned char *base = nullptr;
+	std::size_t mapped_size = 0;
+	TraceFile::TraceHeader *header = nullptr;
+	unsigned char *string_table = nullptr;
+	unsigned char *ring = nullptr;
+	std::uint64_t ring_size = 0;
+	std::mutex register_mutex;
+	std::unordered_map<const TraceSite*,std::uint32_t> site_ids;
+
+	// never reused, unlike the address of the log
+	const std::uint64_t instance = next_instance.fetch_add( 1, std::memory_order_relaxed );
+	static inline std::atomic<std::uint64_t> next_instance = 1;
+
+public:
+	BinaryLog( const std::string & file_name,
+			   std::uint64_t ring_size_ = 4 * 1024 * 1024,
+			   std::uint64_t string_table_size = 64 * 1024 )
+	: ring_size( TraceFile::align8( ring_size_ ) )
+	{
+		using namespace TraceFile;
+
+		fd = open( file_name.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644 );
+
+		if( fd < 0 ) {
+			throw std::system_error( errno, std::generic_category(), "open " + file_name );
+		}
+
+		mapped_size = ring_offset( string_table_size ) + ring_size;
+
+		if( ftruncate( fd, mapped_size ) < 0 ) {
+			const int err = errno;
+			close( fd );
+			throw std::system_error( err, std::generic_category(), "ftruncate " + file_name );
+		}
+
+		void *ptr = mmap( nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+
+		if( ptr == MAP_FAILED ) {
+			const int err = errno;
+			close( fd );
+			throw std::system_error( err, std::generic_category(), "mmap " + file_name );
+		}
+
+		base = static_cast<unsigned char*>(ptr);
+		header = reinterpret_cast<TraceHeader*>(base);
+		string_table = base + string_table_offset();
+		ring = base + ring_offset( string_table_size );
+
+		std::memcpy( header->magic, MAGIC, sizeof(MAGIC) );
+		header->version = VERSION;
+		header->format_count = 0;
+		header->string_table_size = string_table_size;
+		header->string_table_used = 0;
+		header->ring_size = ring_size;
+		header->head = 0;
+		header->tail = 0;
+	}
+
+	~BinaryLog()
+	{
+		munmap( base, mapped_size );
+		close( fd );
+	}
+
+	BinaryLog( const BinaryLog & other ) = delete;
+	BinaryLog & operator=( const BinaryLog & other ) = delete;
+
+	/**
+	 * Called by CO_TRACE. The id is cached per call site and thread,
+	 * so the string table is only searched, when an other log has been
+	 * used at this call site before.
+	 */
+	std::uint32_t format_id( const TraceSite & site, TraceSiteCache & cache )
+	{
+		if( cache.log_instance == instance ) {
+			return cache.id;
+		}
+
+		std::uint32_t id = TraceFile::INVALID_ID;
+
+		{
+			std::lock_guard<std::mutex> lock( register_mutex );
+			auto it = site_ids.find( &site );
+
+			if( it != site_ids.end() ) {
+				id = it->second;
+			}
+		}
+
+		if( id == TraceFile::INVALID_ID ) {
+			id = register_format( site.file, site.line, site.fmt );
+
+			if( id != TraceFile::INVALID_ID ) {
+				std::lock_guard<std::mutex> lock( register_mutex );
+				site_ids.emplace( &site, id );
+			}
+		}
+
+		cache.log_instance = instance;
+		cache.id = id;
+
+		return id;
+	}
+
+	/**
+	 * Returns INVALID_ID if the string table is full.
+	 */
+	std::uint32_t register_format( const char *file, unsigned line, const char *fmt )
+	{
+		using namespace TraceFile;
+
+		std::lock_guard<std::mutex> lock( register_mutex );
+
+		const std::size_t file_len = std::min<std::size_t>( std::strlen( file ), 0xFFFF );
+		const std::size_t fmt_len = std::min<std::size_t>( std::strlen( fmt ), 0xFFFF );
+		const std::uint64_t size = align8( sizeof(TraceFormat) + file_len + fmt_len );
+
+		if( header->string_table_used + size > header->string_table_size ) {
+			return INVALID_ID;
+		}
+
+		unsigned char *pos = string_table + header->string_table_used;
+
+		TraceFormat format{};
+		format.line = line;
+		format.file_len = static_cast<std::uint16_t>(file_len);
+		format.fmt_len = static_cast<std::uint16_t>(fmt_len);
+
+		std::memcpy( pos, &format, sizeof(format) );
+		std::memcpy( pos + sizeof(format), file, file_len );
+		std::memcpy( pos + sizeof(format) + file_len, fmt, fmt_len );
+
+		header->string_table_used += size;
+
+		return header->format_count++;
+	}
+
+	template<class... Args> void write( std::uint32_t id, const Args&... args )
+	{
+		using namespace TraceFile;
+
+		if( id == INVALID_ID ) {
+			return;
+		}
+
+		const std::uint64_t size = align8( sizeof(TraceRecord) + ( encoded_size( args ) + ... + 0 ) );
+
+		if( size > ring_size / 2 ) {
+			return;
+		}
+
+		std::uint64_t pos = header->head;
+		const std::uint64_t space_till_end = ring_size - pos % ring_size;
+		const bool wrap = space_till_end < size;
+
+		make_space( ( wrap ? space_till_end : 0 ) + size );
+
+		if( wrap ) {
+			TraceRecord padding{};
+			padding.size = static_cast<std::uint32_t>(space_till_end);
+			padding.id = PADDING_ID;
+			std::memcpy( ring + pos % ring_size, &padding, sizeof(padding.size) + sizeof(padding.id) );
+			pos += space_till_end;
+		}
+
+		unsigned char *dest = ring + pos % ring_size;
+
+		TraceRecord record{};
+		record.size = static_cast<std::uint32_t>(size);
+		record.id = id;
+		record.timestamp = static_cast<std::uint64_t>(
+				std::chrono::duration_cast<std::chrono::nanoseconds>(
+						std::chrono::system_clock::now().time_since_epoch() ).count() );
+
+		std::memcpy( dest, &record, sizeof(record) );
+		dest += sizeof(record);
+
+		( encode( dest, args ), ... );
+
+		// the decoder stops at a zero type byte, old data of the ring
+		// must not be read as arguments
+		std::memset( dest, 0, ring + pos % ring_size + size - dest );
+
+		std::atomic_ref<std::uint64_t>( header->head ).store( pos + size, std::memory_order_release );
+	}
+
+private:
+	/**
+	 * drops the oldest records, until there is space for size bytes
+	 */
+	void make_space( std::uint64_t size )
+	{
+		std::uint64_t tail = header->tail;
+
+		while( header->head + size - tail > ring_size ) {
+			std::uint32_t record_size = 0;
+			std::memcpy( &record_size, ring + tail % ring_size, sizeof(record_size) );
+			tail += record_size;
+		}
+
+		std::atomic_ref<std::uint64_t>( header->tail ).store( tail, std::memory_order_release );
+	}
+
+	template<class T> static std::string_view as_string( const T & arg )
+	{
+		if constexpr( std::is_pointer_v<T> ) {
+			if( !arg ) {
+				return "(null)";
+			}
+		}
+
+		return std::string_view( arg );
+	}
+
+	template<class T> static std::size_t encoded_size( const T & arg )
+	{
+		if constexpr( std::is_convertible_v<const T&, std::string_view> ) {
+			return 1 + sizeof(std::uint16_t) + std::min<std::size_t>( as_string( arg ).size(), 0xFFFF );
+		} else {
+			static_assert( std::is_arithmetic_v<T> || std::is_enum_v<T> || std::is_pointer_v<T>,
+						   "type not supported by the binary log" );
+			return 1 + sizeof(std::uint64_t);
+		}
+	}
+
+	template<class T> static void encode( unsigned char *& dest, const T & arg )
+	{
+		using namespace TraceFile;
+
+		if constexpr( std::is_convertible_v<const T&, std::string_view> ) {
+			const std::string_view s = as_string( arg );
+			const std::uint16_t len = static_cast<std::uint16_t>( std::min<std::size_t>( s.size(), 0xFFFF ) );
+			*dest++ = ARG_STRING;
+			std::memcpy( dest, &len, sizeof(len) );
+			std::memcpy( dest + sizeof(len), s.data(), len );
+			dest += sizeof(len) + len;
+			return;
+		} else if constexpr( std::is_floating_point_v<T> ) {
+			const double value = arg;
+			*dest++ = ARG_DOUBLE;
+			std::memcpy( dest, &value, sizeof(value) );
+		} else if constexpr( std::is_pointer_v<T> ) {
+			const std::uint64_t value = reinterpret_cast<std::uintptr_t>( arg );
+			*dest++ = ARG_PTR;
+			std::memcpy( dest, &value, sizeof(value) );
+		} else if constexpr( std::is_signed_v<T> || std::is_enum_v<T> ) {
+			const std::int64_t value = static_cast<std::int64_t>( arg );
+			*dest++ = ARG_INT;
+			std::memcpy( dest, &value, sizeof(value) );
+		} else {
+			const std::uint64_t value = static_cast<std::uint64_t>( arg );
+			*dest++ = ARG_UINT;
+			std::memcpy( dest, &value, sizeof(value) );
+		}
+
+		dest += sizeof(std::uint64_t);
+	}
+};
+
+} // namespace CoScheduler
+
+#define CO_TRACE( log, fmt, ... ) \
+	do { \
+		static constexpr CoScheduler::TraceSite co_trace_site{ __FILE__, __LINE__, fmt }; \
+		static thread_local CoScheduler::TraceSiteCache co_trace_cache; \
+		(log).write( (log).format_id( co_trace_site, co_trace_cache ) __VA_OPT__(,) __VA_ARGS__ ); \
+	} while( 0 )
+
+#endif /* SRC_COSCHEDULER_COTRACELOG_HPP_ */
@@ -0,0 +1,172 @@
+/**
+ * Zero copy transfer of data between file descriptors (linux only)
+ * @author Copyright (c) 2024 Martin Oberzalek
+ */
+#pragma once
+#ifndef SRC_COSCHEDULER_COTRANSFER_HPP_
+#define SRC_COSCHEDULER_COTRANSFER_HPP_
+
+#include <sys/sendfile.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include "CoScheduler.hpp"
+#include "CoReactor.hpp"
+
+namespace CoScheduler {
+
+struct TransferResult
+{
+	std::size_t transferred = 0;
+	int         error = 0;	// errno of the failed call, or 0
+};
+
+/**
+ * Sub coroutine, that sends count bytes of a file, starting
+ * at offset, to a non blocking socket via sendfile().
+ * The data does not pass user space.
+ *
+ *   CoScheduler::TransferResult result;
+ *   auto tx = CoScheduler::send_file<Scheduler::yield_type>( conn, file_fd, 0, file_size, result );
+ *   while( tx ) {
+ *       co_yield tx();
+ *   }
+ *
+ * After each chunk the coroutine yields, so other tasks
+ * can run in between, even if the socket never blocks.
+ * Stops at the end of the file.
+ */
+template<class Generator>
+Generator send_file( FdWaiter & out, int file_fd, off_t offset, std::size_t count,
+					 TransferResult & result, std::size_t chunk_size = 64 * 1024 )
+{
+	while( result.transferred < count ) {
+
+		const std::size_t len = std::min( chunk_size, count - result.transferred );
+		const ssize_t ret = sendfile( out.get_fd(), file_fd, &offset, len );
+
+		if( ret < 0 ) {
+			if( errno == EAGAIN ) {
+				co_yield YIELD( out.writable() );
+				continue;
+			}
+
+			if( errno == EINTR ) {
+				continue;
+			}
+
+			result.error = errno;
+			co_return;
+		}
+
+		if( ret == 0 ) {
+			// end of file
+			co_return;
+		}
+
+		result.transferred += static_cast<std::size_t>(ret);
+
+		co_yield YIELD();
+	}
+}
+
+/**
+ * Sub coroutine, that moves count bytes from in_fd to out via splice(),
+ * through a pipe, so the data stays in the kernel.
+ *
+ * in is the reactor registration of in_fd, if in_fd is a socket or a pipe.
+ * Pass nullptr for regular files, they can't be used with epoll,
+ * but they never block either.
+ *
+ * Yields after each chunk, like send_file().
+ */
+template<class Generator>
+Generator splice_fd( int in_fd, FdWaiter *in, FdWaiter & out, std::size_t count,
+					 TransferResult & result, std::size_t chunk_size = 64 * 1024 )
+{
+	struct Pipe
+	{
+		int fds[2] = { -1, -1 };
+
+		~Pipe() {
+			for( int fd : fds ) {
+				if( fd >= 0 ) {
+					close( fd );
+				}
+			}
+		}
+	} buffer_pipe;
+
+	if( pipe2( buffer_pipe.fds, O_NONBLOCK | O_CLOEXEC ) < 0 ) {
+		result.error = errno;
+		co_return;
+	}
+
+	std::size_t in_pipe = 0;
+	bool eof = false;
+
+	while( result.transferred < count ) {
+
+		if( in_pipe == 0 && !eof ) {
+			const std::size_t len = std::min( chunk_size, count - result.transferred );
+			const ssize_t ret = splice( in_fd, nullptr, buffer_pipe.fds[1], nullptr, len,
+										SPLICE_F_MOVE | SPLICE_F_NONBLOCK );
+
+			if( ret < 0 ) {
+				if( errno == EAGAIN ) {
+					if( in ) {
+						co_yield YIELD( in->readable() );
+					} else {
+						co_yield YIELD();
+					}
+					continue;
+				}
+
+				if( errno == EINTR ) {
+					continue;
+				}
+
+				result.error = errno;
+				co_return;
+			}
+
+			if( ret == 0 ) {
+				eof = true;
+			}
+
+			in_pipe = static_cast<std::size_t>(ret);
+		}
+
+		if( in_pipe == 0 ) {
+			co_return;
+		}
+
+		const ssize_t ret = splice( buffer_pipe.fds[0], nullptr, out.get_fd(), nullptr, in_pipe,
+									SPLICE_F_MOVE | SPLICE_F_NONBLOCK );
+
+		if( ret < 0 ) {
+			if( errno == EAGAIN ) {
+				co_yield YIELD( out.writable() );
+				continue;
+			}
+
+			if( errno == EINTR ) {
+				continue;
+			}
+
+			result.error = errno;
+			co_return;
+		}
+
+		in_pipe -= static_cast<std::size_t>(ret);
+		result.transferred += static_cast<std::size_t>(ret);
+
+		co_yield YIELD();
+	}
+}
+
+} // namespace CoScheduler
+
+#endif /* SRC_COSCHEDULER_COTRANSFER_HPP_ */
@@ -0,0 +1,274 @@
+/**
+ * Detection of tasks, that don't co_yield in time (linux only)
+ * @author Copyright (c) 2024 Martin Oberzalek
+ */
+#pragma once
+#ifndef SRC_COSCHEDULER_COWATCHDOG_HPP_
+#define SRC_COSCHEDULER_COWATCHDOG_HPP_
+
+#include <execinfo.h>
+#include <pthread.h>
+#include <signal.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <format.h>
+#include <OutDebug.h>
+#include "CoScheduler.hpp"
+
+namespace CoScheduler {
+
+struct WatchdogOptions
+{
+	// for tasks without an expected_duration
+	std::chrono::nanoseconds budget = std::chrono::milliseconds( 100 );
+
+	// if false, budget is used for all tasks
+	bool use_expected_duration = true;
+
+	std::chrono::nanoseconds check_interval = std::chrono::milliseconds( 10 );
+
+	// abort() after the overrun has been reported
+	bool abort_on_overrun = false;
+
+	// sent to the scheduler thread to record its backtrace, 0 disables it
+	int backtrace_signal = SIGUSR2;
+};
+
+/**
+ * state of the scheduler, when a task exceeded its budget
+ */
+struct WatchdogReport
+{
+	const void *task = nullptr;
+	std::chrono::nanoseconds running{};
+	std::chrono::nanoseconds budget{};
+	std::uint64_t resumes = 0;		// of the task, before this one
+	std::size_t task_count = 0;
+	std::vector<std::string> backtrace;	// of the scheduler thread
+};
+
+/**
+ * Thread, that checks how long the current task of a scheduler
+ * is running. Scheduling is cooperative, so a task, that doesn't
+ * co_yield, stalls all other tasks of the scheduler.
+ *
+ *   Scheduler sch;
+ *   CoScheduler::Watchdog<Scheduler> watchdog( sch );
+ *
+ *   sch.infinite_schedule();
+ *
+ * A task may run for its YIELD::expected_duration, tasks without
+ * one for WatchdogOptions::budget. Each overrun is reported once
+ * by on_overrun(), with the backtrace of the scheduler thread.
+ * The backtrace is recorded by a signal handler in the stalled
+ * thread, so the signal must not be used otherwise.
+ *
+ * The watchdog has to be created in the scheduler thread, before
+ * the scheduler is started, or the thread has to be passed.
+ * Destroy it in the scheduler thread, or after the scheduler
+ * has been stopped, the running task may still report to it otherwise.
+ */
+template<class SchedulerType> class Watchdog
+{
+	static constexpr int MAX_FRAMES = 64;
+
+	// written by the signal handler
+	struct Capture
+	{
+		void *frames[MAX_FRAMES];
+		std::atomic<int> count = 0;
+		std::atomic<bool> done = false;
+	};
+
+	SchedulerType & scheduler;
+	const WatchdogOptions options;
+	const pthread_t scheduler_thread;
+	RunningTask running_task;
+	struct sigaction old_action{};
+
+	std::mutex m;
+	std::condition_variable cond;
+	bool stopping = false;
+	std::thread thread;
+
+	static inline Capture capture;
+	// one backtrace at a time, the handler is shared
+	static inline std::mutex capture_mutex;
+
+public:
+	Watchdog( SchedulerType & scheduler_,
+			  const WatchdogOptions & options_ = {},
+			  pthread_t scheduler_thread_ = pthread_self() )
+	: scheduler( scheduler_ ),
+	  options( options_ ),
+	  scheduler_thread( scheduler_thread_ )
+	{
+		if( options.backtrace_signal ) {
+			// loads libgcc, so backtrace() is safe in the signal handler later
+			void *frames[1];
+			::backtrace( frames, 1 );
+
+			struct sigaction action{};
+			action.sa_handler = record_backtrace;
+			action.sa_flags = SA_RESTART;
+			sigemptyset( &action.sa_mask );
+			sigaction( options.backtrace_signal, &action, &old_action );
+		}
+
+		scheduler.set_running_task_monitor( &running_task );
+
+		thread = std::thread( [this]() {
+			watch();
+		});
+	}
+
+	virtual ~Watchdog()
+	{
+		{
+			std::lock_guard<std::mutex> lock( m );
+			stopping = true;
+		}
+
+		cond.notify_all();
+		thread.join();
+
+		scheduler.set_running_task_monitor( nullptr );
+
+		if( options.backtrace_signal ) {
+			sigaction( options.backtrace_signal, &old_action, nullptr );
+		}
+	}
+
+	Watchdog( const Watchdog & other ) = delete;
+	Watchdog & operator=( const Watchdog & other ) = delete;
+
+protected:
+	/**
+	 * called in the watchdog thread, the task is still running.
+	 * No lock of the watchdog is held, so this may take its time.
+	 */
+	virtual void on_overrun( const WatchdogReport & report )
+	{
+		CPPDEBUG( Tools::format( "task %p running for %dms, budget %dms, resumed %d times before, %d tasks in scheduler",
+								 report.task,
+								 std::chrono::duration_cast<std::chrono::milliseconds>( report.running ).count(),
+								 std::chrono::duration_cast<std::chrono::milliseconds>( report.budget ).count(),
+								 report.resumes,
+								 report.task_count ) );
+
+		for( const std::string & frame : report.backtrace ) {
+			CPPDEBUG( frame );
+		}
+	}
+
+private:
+	void watch()
+	{
+		std::uint64_t reported_sequence = 0;
+		std::unique_lock<std::mutex> lock( m );
+
+		while( !cond.wait_for( lock, options.check_interval, [this]() { return stopping; } ) ) {
+
+			WatchdogReport report;
+			const std::uint64_t sequence = running_task.sequence.load( std::memory_order_acquire );
+
+			if( sequence == reported_sequence ) {
+				continue;
+			}
+
+			report.task = running_task.task.load( std::memory_order_relaxed );
+			const std::chrono::nanoseconds since( running_task.since_ns.load( std::memory_order_relaxed ) );
+			const std::chrono::nanoseconds expected( running_task.expected_ns.load( std::memory_order_relaxed ) );
+			report.resumes = running_task.resumes.load( std::memory_order_relaxed );
+			report.task_count = running_task.task_count.load( std::memory_order_relaxed );
+
+			// the task has yielded in the meantime
+			if( !report.task || running_task.sequence.load( std::memory_order_acquire ) != sequence ) {
+				continue;
+			}
+
+			report.budget = options.budget;
+
+			if( options.use_expected_duration && expected.count() > 0 ) {
+				report.budget = expected;
+			}
+
+			report.running = std::chrono::steady_clock::now().time_since_epoch() - since;
+
+			if( report.running <= report.budget ) {
+				continue;
+			}
+
+			reported_sequence = sequence;
+
+			// the destructor must not wait for the backtrace and the report
+			lock.unlock();
+
+			if( options.backtrace_signal ) {
+				report.backtrace = backtrace_of_scheduler();
+			}
+
+			on_overrun( report );
+
+			if( options.abort_on_overrun ) {
+				std::abort();
+			}
+
+			lock.lock();
+		}
+	}
+
+	std::vector<std::string> backtrace_of_scheduler()
+	{
+		std::lock_guard<std::mutex> lock( capture_mutex );
+		std::vector<std::string> lines;
+
+		capture.done.store( false, std::memory_order_relaxed );
+
+		if( pthread_kill( scheduler_thread, options.backtrace_signal ) != 0 ) {
+			return lines;
+		}
+
+		const auto timeout = std::chrono::steady_clock::now() + std::chrono::milliseconds( 100 );
+
+		while( !capture.done.load( std::memory_order_acquire ) ) {
+			if( std::chrono::steady_clock::now() > timeout ) {
+				return lines;
+			}
+
+			std::this_thread::yield();
+		}
+
+		const int count = capture.count.load( std::memory_order_relaxed );
+		char **symbols = backtrace_symbols( capture.frames, count );
+
+		if( !symbols ) {
+			return lines;
+		}
+
+		for( int i = 0; i < count; i++ ) {
+			lines.emplace_back( symbols[i] );
+		}
+
+		free( symbols );
+
+		return lines;
+	}
+
+	static void record_backtrace( int )
+	{
+		capture.count.store( ::backtrace( capture.frames, MAX_FRAMES ), std::memory_order_relaxed );
+		capture.done.store( true, std::memory_order_release );
+	}
+};
+
+} // namespace CoScheduler
+
+#endif /* SRC_COSCHEDULER_COWATCHDOG_HPP_ */
@@ -0,0 +1,240 @@
+/**
+ * Run sub coroutines concurrently and wait for all, or the first of them
+ * @author Copyright (c) 2024 Martin Oberzalek
+ */
+#pragma once
+#ifndef SRC_COSCHEDULER_COWHEN_HPP_
+#define SRC_COSCHEDULER_COWHEN_HPP_
+
+#include <array>
+#include <cstddef>
+#include "CoScheduler.hpp"
+
+namespace CoScheduler {
+
+/**
+ * Holds a fixed number of sub coroutines and resumes them
+ * interleaved, each one as soon as its own YIELD is ready.
+ *
+ * The group behaves like a generator, so it can be used the same
+ * way as a single sub coroutine:
+ *
+ *   auto all = CoScheduler::when_all( sub_a(), sub_b() );
+ *   while( all ) {
+ *       co_yield all();
+ *   }
+ *
+ * The YIELD returned by operator()() is the earliest next_run of
+ * all sub coroutines. If one of them is waiting for an object,
+ * the group itself is the wait object and the earliest next_run
+ * is the timeout.
+ */
+template<class Generator, std::size_t N> class GeneratorGroup : public WaitForBase
+{
+protected:
+	mutable std::array<Generator,N> children;
+	std::array<bool,N>              finished{};
+	std::size_t                     count_finished = 0;
+	bool                            full = false;
+
+public:
+	template<class... Generators> GeneratorGroup( Generators&&... generators )
+	: children{ { std::forward<Generators>(generators)... } }
+	{}
+
+	GeneratorGroup( const GeneratorGroup & other ) = delete;
+	GeneratorGroup & operator=( const GeneratorGroup & other ) = delete;
+
+	bool condition_reached() const override
+	{
+		const auto now = YIELD::clock::now();
+
+		for( std::size_t i = 0; i < N; i++ ) {
+			if( !finished[i] && child_value( i ).ready( now ) ) {
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	YIELD operator()()
+	{
+		fill();
+		full = false;
+		return next_yield();
+	}
+
+protected:
+	YIELD & child_value( std::size_t idx ) const {
+		return children[idx].get_handle().promise().value_;
+	}
+
+	void fill( bool stop_at_first_finished )
+	{
+		if( full ) {
+			return;
+		}
+
+		full = true;
+
+		const auto now = YIELD::clock::now();
+
+		for( std::size_t i = 0; i < N; i++ ) {
+
+			if( finished[i] || !child_value( i ).ready( now ) ) {
+				continue;
+			}
+
+			children[i]();
+
+			if( children[i].finished() ) {
+				finished[i] = true;
+				count_finished++;
+
+				if( stop_at_first_finished ) {
+					return;
+				}
+			}
+		}
+	}
+
+	virtual void fill() = 0;
+
+	YIELD next_yield()
+	{
+		bool waiting = false;
+		bool has_next_run = false;
+		YIELD::timepoint_t next_run{};
+
+		for( std::size_t i = 0; i < N; i++ ) {
+
+			if( finished[i] ) {
+				continue;
+			}
+
+			const YIELD & value = child_value( i );
+
+			if( value.wait_for_object ) {
+				waiting = true;
+
+				if( !value.has_timeout ) {
+					continue;
+				}
+			}
+
+			if( !has_next_run || value.next_run < next_run ) {
+				next_run = value.next_run;
+				has_next_run = true;
+			}
+		}
+
+		if( !waiting ) {
+			YIELD ret;
+			ret.next_run = next_run;
+			return ret;
+		}
+
+		YIELD ret( *this );
+
+		if( has_next_run ) {
+			ret.next_run = next_run;
+			ret.has_timeout = true;
+		}
+
+		return ret;
+	}
+};
+
+/**
+ * finished, when all sub coroutines are finished
+ */
+template<class Generator, std::size_t N> class WhenAll : public GeneratorGroup<Generator,N>
+{
+	using base = GeneratorGroup<Generator,N>;
+
+public:
+	using base::base;
+
+	explicit operator bool()
+	{
+		fill();
+		return base::count_finished < N;
+	}
+
+protected:
+	void fill() override {
+		base::fill( false );
+	}
+};
+
+/**
+ * finished, when the first sub coroutine is finished.
+ * All others are destroyed at this point.
+ */
+template<class Generator, std::size_t N> class WhenAny : public GeneratorGroup<Generator,N>
+{
+	using base = GeneratorGroup<Generator,N>;
+
+public:
+	static constexpr std::size_t NONE = N;
+
+private:
+	std::size_t winner_idx = NONE;
+
+public:
+	using base::base;
+
+	explicit operator bool()
+	{
+		fill();
+		return winner_idx == NONE;
+	}
+
+	/**
+	 * index of the sub coroutine that finished first,
+	 * or NONE, if still running
+	 */
+	std::size_t winner() const {
+		return winner_idx;
+	}
+
+protected:
+	void fill() override
+	{
+		if( winner_idx != NONE ) {
+			return;
+		}
+
+		base::fill( true );
+
+		if( base::count_finished == 0 ) {
+			return;
+		}
+
+		for( std::size_t i = 0; i < N; i++ ) {
+			if( base::finished[i] ) {
+				winner_idx = i;
+			} else {
+				base::children[i].reset();
+				base::finished[i] = true;
+			}
+		}
+	}
+};
+
+template<class Generator, class... Generators>
+WhenAll<Generator,1 + sizeof...(Generators)> when_all( Generator first, Generators... others )
+{
+	return WhenAll<Generator,1 + sizeof...(Generators)>( std::move(first), std::move(others)... );
+}
+
+template<class Generator, class... Generators>
+WhenAny<Generator,1 + sizeof...(Generators)> when_any( Generator first, Generators... others )
+{
+	return WhenAny<Generator,1 + sizeof...(Generators)>( std::move(first), std::move(others)... );
+}
+
+} // namespace CoScheduler
+
+#endif /* SRC_COSCHEDULER_COWHEN_HPP_ */
@@ -7,10 +7,11 @@
 #include <format.h>
 #include <chrono>
 #include <coroutine>
-#include "date.h"
+#include "TimeFormat.h"
 #include <thread>
 #include "coscheduler/CoScheduler.hpp"
 #include "coscheduler/CoGenerator.hpp"
+#include "coscheduler/CoLog.hpp"
 #include "CoSchedulerDynamicConf.h"
 
 using namespace std::chrono_literals;
@@ -19,38 +20,13 @@ using namespace Tools;
 
 using Scheduler = CoScheduler::Scheduler<DynamicConf>;
 using YIELD = CoScheduler::YIELD;
+using log_timestamp = CoScheduler::log_timestamp;
 
-
-static std::string to_hhmmssms( const std::chrono::time_point<std::chrono::system_clock> tp )
-{
-	using namespace std::chrono;
-
-	auto dp = date::floor<date::days>(tp);  // dp is a sys_days, which is a
-	                                      // type alias for a C::time_point
-	//auto ymd = date::year_month_day{dp};
-	auto time = date::make_time(duration_cast<milliseconds>(tp-dp));
-
-	return format("%02d:%02d:%02d.%04d",
-			time.hours().count(),
-			time.minutes().count(),
-			time.seconds().count(),
-			time.subseconds().count() );
-}
-
-static std::string to_hhmmss( const std::chrono::time_point<std::chrono::system_clock> tp )
-{
-	using namespace std::chrono;
-
-	auto dp = date::floor<date::days>(tp);  // dp is a sys_days, which is a
-	                                      // type alias for a C::time_point
-	//auto ymd = date::year_month_day{dp};
-	auto time = date::make_time(duration_cast<milliseconds>(tp-dp));
-
-	return Tools::format("%02d:%02d:%02d",
-			time.hours().count(),
-			time.minutes().count(),
-			time.seconds().count() );
-}
+/*
+ * the tasks are only writing into the log ring,
+ * formatting and output is done by the drain task
+ */
+static CoScheduler::AsyncLog<> async_log;
 
 
 Scheduler::yield_type task_function_a()
@@ -59,7 +35,7 @@ Scheduler::yield_type task_function_a()
 
 	while( true )
 	{
-		CPPDEBUG( Tools::format( "%s: %s", __FUNCTION__, to_hhmmssms(system_clock::now()) ) );
+		CO_DEBUG( async_log, "%s: %s", __FUNCTION__, log_timestamp() );
 		co_yield YIELD( shedule_time, 1ms );
 	}
 
@@ -76,7 +52,7 @@ Scheduler::yield_type task_function_b()
 	{
 		auto diff = std::chrono::duration_cast<std::chrono::milliseconds>(system_clock::now() - last_run);
 
-		CPPDEBUG( Tools::format( "%s: %s diff: %dms", __FUNCTION__, to_hhmmssms(system_clock::now()), diff.count() ) );
+		CO_DEBUG( async_log, "%s: %s diff: %dms", __FUNCTION__, log_timestamp(), diff.count() );
 		last_run = system_clock::now();
 
 		auto next_delay = shedule_time;
@@ -101,7 +77,7 @@ Scheduler::yield_type sub_function_c()
 	{
 		auto diff = std::chrono::duration_cast<std::chrono::milliseconds>(system_clock::now() - last_run);
 
-		CPPDEBUG( Tools::format( "%s: %s count: %d diff: %dms", __FUNCTION__, to_hhmmssms(system_clock::now()), i, diff.count() ) );
+		CO_DEBUG( async_log, "%s: %s count: %d diff: %dms", __FUNCTION__, log_timestamp(), i, diff.count() );
 		last_run = system_clock::now();
 		co_yield YIELD( shedule_time, 1ms );
 	}
@@ -115,7 +91,7 @@ Scheduler::yield_type task_function_c()
 
 	while( true )
 	{
-		CPPDEBUG( Tools::format( "%s: %s", __FUNCTION__, to_hhmmssms(system_clock::now()) ) );
+		CO_DEBUG( async_log, "%s: %s", __FUNCTION__, log_timestamp() );
 
 		auto sub = sub_function_c();
 		while( sub ) {
@@ -137,13 +113,17 @@ int main( int argc, char **argv )
 
 		Scheduler sch;
 
+		async_log.set_time_formatter( to_hhmmssms );
+
 		auto task_a = task_function_a();
 		auto task_b = task_function_b();
 		auto task_c = task_function_c();
+		auto task_log = async_log.drain_task<Scheduler::yield_type>( 100ms );
 
 		sch.add_task_reference( task_a );
 		sch.add_task_reference( task_b );
 		sch.add_task_reference( task_c );
+		sch.add_task_reference( task_log );
 
 
 		sch.infinite_schedule();
@@ -0,0 +1,121 @@
+/**
+ * Periodic tasks are moved from a busy shard to idle ones by the LoadBalancer
+ * @author Copyright (c) 2024 Martin Oberzalek
+ */
+#include <iostream>
+#include <OutDebug.h>
+#include <format.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "coscheduler/CoScheduler.hpp"
+#include "coscheduler/CoGenerator.hpp"
+#include "coscheduler/CoShard.hpp"
+#include "coscheduler/CoBalancer.hpp"
+#include "CoSchedulerDynamicConf.h"
+#include "TestCheck.h"
+
+using namespace std::chrono_literals;
+using namespace Tools;
+using namespace TestCheck;
+
+using Shard = CoScheduler::Shard<DynamicConf>;
+using ShardGroup = CoScheduler::ShardGroup<DynamicConf>;
+using LoadBalancer = CoScheduler::LoadBalancer<DynamicConf>;
+using YIELD = CoScheduler::YIELD;
+
+static constexpr int BUSY_TASKS = 8;
+
+std::atomic<int> running_tasks = 0;
+
+// runs 2ms every 10ms, so all of them together overload one shard
+Shard::yield_type busy()
+{
+	running_tasks++;
+
+	while( true ) {
+		co_yield YIELD( 10ms );
+
+		const auto end = std::chrono::steady_clock::now() + 2ms;
+
+		while( std::chrono::steady_clock::now() < end ) {
+		}
+	}
+}
+
+std::size_t task_count( ShardGroup & group, unsigned idx )
+{
+	return group.get_shard( idx ).get_task_count();
+}
+
+// tasks, that are just moved, are not counted
+std::size_t total_task_count( ShardGroup & group )
+{
+	std::size_t total = 0;
+
+	for( unsigned i = 0; i < group.size(); i++ ) {
+		total += task_count( group, i );
+	}
+
+	return total;
+}
+
+int main( int argc, char **argv )
+{
+	Tools::x_debug = new OutDebug();
+
+	try {
+		ShardGroup group( 4 );
+		LoadBalancer balancer( group );
+
+		for( int i = 0; i < BUSY_TASKS; i++ ) {
+			group.spawn( 0, []() {
+				return busy();
+			});
+		}
+
+		group.spawn( 0, [&balancer]() {
+			return balancer.task<Shard::yield_type>( 200ms );
+		});
+
+		const auto timeout = std::chrono::steady_clock::now() + 10s;
+
+		// the factories are run by the shard
+		while( running_tasks < BUSY_TASKS && std::chrono::steady_clock::now() < timeout ) {
+			std::this_thread::sleep_for( 10ms );
+		}
+
+		// the balancer moves one task per period
+		while( task_count( group, 0 ) > 4 && std::chrono::steady_clock::now() < timeout ) {
+			std::this_thread::sleep_for( 100ms );
+		}
+
+		while( total_task_count( group ) != BUSY_TASKS + 1 && std::chrono::steady_clock::now() < timeout ) {
+			std::this_thread::sleep_for( 1ms );
+		}
+
+		const std::size_t total = total_task_count( group );
+		unsigned used_shards = 0;
+
+		for( unsigned i = 0; i < group.size(); i++ ) {
+			CPPDEBUG( format( "shard %d: %d tasks", i, task_count( group, i ) ) );
+
+			if( task_count( group, i ) ) {
+				used_shards++;
+			}
+		}
+
+		check( task_count( group, 0 ) <= 4, format( "tasks moved away from the busy shard: %d left", task_count( group, 0 ) ) );
+		check( used_shards > 1, format( "tasks are spread over %d shards", used_shards ) );
+		check( total == BUSY_TASKS + 1, format( "no task got lost: %d", total ) );
+		check( running_tasks == BUSY_TASKS, format( "each task started once: %d", running_tasks.load() ) );
+
+		group.stop();
+
+	} catch( const std::exception & error ) {
+		std::cout << "Error: " << error.what() << std::endl;
+		return 1;
+	}
+
+	return result();
+}
@@ -0,0 +1,91 @@
+/**
+ * A Conf written to the first scheduler interface, without
+ * remote task inbox, idle waiter and idle timeout, still works
+ * @author Copyright (c) 2024 Martin Oberzalek
+ */
+#include <iostream>
+#include <OutDebug.h>
+#include <format.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "coscheduler/CoScheduler.hpp"
+#include "coscheduler/CoGenerator.hpp"
+#include "TestCheck.h"
+
+using namespace std::chrono_literals;
+using namespace Tools;
+using namespace TestCheck;
+
+struct BaselineConf
+{
+	using yield_type = CoScheduler::CoGenerator<CoScheduler::YIELD>;
+
+	using CONTAINER_TASKS            = std::vector<yield_type*>;
+	using CONTAINER_WAITABLE_OBJECTS = std::vector<CoScheduler::WaitForBase*>;
+	using CONTAINER_WAIT_OBJECTS     = std::vector<CoScheduler::WaitForBase*>;
+
+	static inline int idle_calls = 0;
+
+	inline static void idle()
+	{
+		idle_calls++;
+		std::this_thread::sleep_for( 1ms );
+	}
+};
+
+using Scheduler = CoScheduler::Scheduler<BaselineConf>;
+using YIELD = CoScheduler::YIELD;
+
+static constexpr int REMOTE_TASKS = 50;
+
+Scheduler sch;
+int finished = 0;
+
+Scheduler::yield_type task_function()
+{
+	co_yield YIELD( 2ms );
+
+	if( ++finished == REMOTE_TASKS ) {
+		sch.stop();
+	}
+}
+
+int main( int argc, char **argv )
+{
+	Tools::x_debug = new OutDebug();
+
+	try {
+		std::vector<Scheduler::yield_type> tasks;
+
+		for( int i = 0; i < REMOTE_TASKS; i++ ) {
+			tasks.push_back( task_function() );
+		}
+
+		int accepted = 0;
+
+		// handed over through the default inbox
+		std::thread producer( [&tasks,&accepted]() {
+			for( auto & task : tasks ) {
+				if( sch.add_remote_task_reference( task ) ) {
+					accepted++;
+				}
+
+				std::this_thread::sleep_for( 100us );
+			}
+		});
+
+		sch.infinite_schedule();
+		producer.join();
+
+		check( accepted == REMOTE_TASKS, format( "all remote tasks accepted: %d", accepted ) );
+		check( finished == REMOTE_TASKS, format( "all remote tasks finished: %d", finished ) );
+		check( BaselineConf::idle_calls > 0, "Conf::idle() without arguments is called" );
+
+	} catch( const std::exception & error ) {
+		std::cout << "Error: " << error.what() << std::endl;
+		return 1;
+	}
+
+	return result();
+}
@@ -0,0 +1,96 @@
+/**
+ * Cooperative cancellation of waiting tasks with CancelToken
+ * @author Copyright (c) 2024 Martin Oberzalek
+ */
+#include <iostream>
+#include <OutDebug.h>
+#include <format.h>
+#include <chrono>
+#include "coscheduler/CoScheduler.hpp"
+#include "coscheduler/CoGenerator.hpp"
+#include "CoSchedulerDynamicConf.h"
+#include "TestCheck.h"
+
+using namespace std::chrono_literals;
+using namespace Tools;
+using namespace TestCheck;
+
+using Scheduler = CoScheduler::Scheduler<DynamicConf>;
+using YIELD = CoScheduler::YIELD;
+
+// referenced by the tasks, so they are destroyed after the scheduler
+CoScheduler::mutex locked_mutex;
+CoScheduler::CancelToken root;
+CoScheduler::CancelToken child( &root );
+CoScheduler::CancelToken other;
+
+Scheduler sch;
+
+const auto start = std::chrono::steady_clock::now();
+bool mutex_waiter_cancelled = false;
+bool cancel_is_sticky = false;
+bool sleeper_cancelled = false;
+bool other_resumed = false;
+
+Scheduler::yield_type mutex_waiter()
+{
+	const YIELD & result = co_yield YIELD( locked_mutex );
+	mutex_waiter_cancelled = result.cancelled() && result.wakeup_reason == YIELD::WakeupReason::CANCELLED;
+
+	// a cancelled task is resumed at once, when it yields again
+	const YIELD & again = co_yield YIELD( 10s );
+	cancel_is_sticky = again.cancelled();
+}
+
+Scheduler::yield_type sleeper()
+{
+	const YIELD & result = co_yield YIELD( 10s );
+	sleeper_cancelled = result.cancelled();
+}
+
+Scheduler::yield_type other_waiter()
+{
+	co_yield YIELD( locked_mutex );
+	other_resumed = true;
+}
+
+Scheduler::yield_type canceller()
+{
+	co_yield YIELD( 20ms );
+	root.cancel();
+}
+
+Scheduler::yield_type stopper()
+{
+	co_yield YIELD( 50ms );
+	sch.stop();
+}
+
+int main( int argc, char **argv )
+{
+	Tools::x_debug = new OutDebug();
+
+	try {
+		locked_mutex.try_lock();
+
+		sch.spawn( mutex_waiter(), root );
+		sch.spawn( sleeper(), child );
+		sch.spawn( other_waiter(), other );
+		sch.spawn( canceller() );
+		sch.spawn( stopper() );
+
+		sch.infinite_schedule();
+
+		check( mutex_waiter_cancelled, "task waiting for a mutex is cancelled" );
+		check( cancel_is_sticky, "cancellation is reported on the next yield too" );
+		check( sleeper_cancelled, "cancelling the parent token cancels the child token" );
+		check( !other_resumed, "tasks with an other token keep waiting" );
+		check( std::chrono::steady_clock::now() - start < 5s, "cancelled tasks don't wait for their timeout" );
+
+	} catch( const std::exception & error ) {
+		std::cout << "Error: " << error.what() << std::endl;
+		return 1;
+	}
+
+	return result();
+}
@@ -0,0 +1,415 @@
+/**
+ * ChromeTrace: the written file is parsed again and the events
+ * are compared with the task runs
+ * @author Copyright (c) 2024 Martin Oberzalek
+ */
+#include <iostream>
+#include <OutDebug.h>
+#include <format.h>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "coscheduler/CoScheduler.hpp"
+#include "coscheduler/CoGenerator.hpp"
+#include "coscheduler/CoChromeTrace.hpp"
+#include "CoSchedulerDynamicConf.h"
+#include "TestCheck.h"
+
+using namespace std::chrono_literals;
+using namespace Tools;
+using namespace TestCheck;
+
+using Scheduler = CoScheduler::Scheduler<DynamicConf>;
+using YIELD = CoScheduler::YIELD;
+
+/**
+ * just enough JSON for the trace
+ */
+struct Json
+{
+	enum class Type { NUL, BOOL, NUMBER, STRING, ARRAY, OBJECT };
+
+	Type type = Type::NUL;
+	bool boolean = false;
+	double number = 0;
+	std::string string;
+	std::vector<Json> items;
+	std::vector<std::string> keys;
+
+	const Json * get( const std::string & key ) const
+	{
+		for( std::size_t i = 0; i < keys.size(); i++ ) {
+			if( keys[i] == key ) {
+				return &items[i];
+			}
+		}
+
+		return nullptr;
+	}
+
+	std::string get_string( const std::string & key ) const
+	{
+		const Json *value = get( key );
+		return value && value->type == Type::STRING ? value->string : std::string();
+	}
+};
+
+class JsonParser
+{
+	const std::string & text;
+	std::size_t pos = 0;
+
+public:
+	JsonParser( const std::string & text_ )
+	: text( text_ )
+	{}
+
+	Json parse()
+	{
+		Json value = parse_value();
+		skip_space();
+
+		if( pos != text.size() ) {
+			fail( "trailing data" );
+		}
+
+		return value;
+	}
+
+private:
+	[[noreturn]] void fail( const std::string & what ) const {
+		throw std::runtime_error( format( "JSON: %s at %d", what, pos ) );
+	}
+
+	void skip_space() {
+		while( pos < text.size() && std::isspace( static_cast<unsigned char>( text[pos] ) ) ) {
+			pos++;
+		}
+	}
+
+	void expect( char c ) {
+		skip_space();
+
+		if( pos >= text.size() || text[pos] != c ) {
+			fail( std::string( "expected " ) + c );
+		}
+
+		pos++;
+	}
+
+	bool next_is( char c ) {
+		skip_space();
+		return pos < text.size() && text[pos] == c;
+	}
+
+	Json parse_value()
+	{
+		skip_space();
+
+		if( pos >= text.size() ) {
+			fail( "unexpected end" );
+		}
+
+		Json value;
+
+		switch( text[pos] )
+		{
+		case '{':
+			value.type = Json::Type::OBJECT;
+			pos++;
+
+			if( next_is( '}' ) ) {
+				pos++;
+				return value;
+			}
+
+			do {
+				skip_space();
+				value.keys.push_back( parse_string() );
+				expect( ':' );
+				value.items.push_back( parse_value() );
+			} while( next_is( ',' ) && ++pos );
+
+			expect( '}' );
+			return value;
+
+		case '[':
+			value.type = Json::Type::ARRAY;
+			pos++;
+
+			if( next_is( ']' ) ) {
+				pos++;
+				return value;
+			}
+
+			do {
+				value.items.push_back( parse_value() );
+			} while( next_is( ',' ) && ++pos );
+
+			expect( ']' );
+			return value;
+
+		case '"':
+			value.type = Json::Type::STRING;
+			value.string = parse_string();
+			return value;
+
+		case 't':
+		case 'f':
+		case 'n':
+			return parse_literal();
+
+		default:
+			value.type = Json::Type::NUMBER;
+			value.number = parse_number();
+			return value;
+		}
+	}
+
+	Json parse_literal()
+	{
+		Json value;
+
+		for( const char *literal : { "true", "false", "null" } ) {
+			const std::string word( literal );
+
+			if( text.compare( pos, word.size(), word ) == 0 ) {
+				pos += word.size();
+				value.type = word == "null" ? Json::Type::NUL : Json::Type::BOOL;
+				value.boolean = word == "true";
+				return value;
+			}
+		}
+
+		fail( "unknown literal" );
+	}
+
+	double parse_number()
+	{
+		const char *start = text.c_str() + pos;
+		char *end = nullptr;
+		const double number = std::strtod( start, &end );
+
+		if( end == start ) {
+			fail( "number expected" );
+		}
+
+		pos += static_cast<std::size_t>( end - start );
+		return number;
+	}
+
+	std::string parse_string()
+	{
+		if( pos >= text.size() || text[pos] != '"' ) {
+			fail( "string expected" );
+		}
+
+		pos++;
+		std::string s;
+
+		while( pos < text.size() && text[pos] != '"' ) {
+			char c = text[pos++];
+
+			if( static_cast<unsigned char>( c ) < 0x20 ) {
+				fail( "control character in string" );
+			}
+
+			if( c == '\\' ) {
+				if( pos >= text.size() ) {
+					fail( "unexpected end" );
+				}
+
+				c = text[pos++];
+
+				switch( c )
+				{
+				case 'n': s += '\n'; break;
+				case 't': s += '\t'; break;
+				case 'u':
+					s += static_cast<char>( std::stoi( text.substr( pos, 4 ), nullptr, 16 ) );
+					pos += 4;
+					break;
+				default: s += c; break;
+				}
+				continue;
+			}
+
+			s += c;
+		}
+
+		if( pos >= text.size() ) {
+			fail( "unterminated string" );
+		}
+
+		pos++;
+		return s;
+	}
+};
+
+class Flag : public CoScheduler::WaitForBase
+{
+public:
+	bool set = false;
+
+	bool condition_reached() const override {
+		return set;
+	}
+};
+
+Scheduler sch;
+Flag flag;
+int finished = 0;
+
+Scheduler::yield_type periodic()
+{
+	for( int i = 0; i < 5; i++ ) {
+		co_yield YIELD( 2ms );
+	}
+
+	flag.set = true;
+	finished++;
+}
+
+Scheduler::yield_type waiter()
+{
+	co_yield YIELD( flag );
+	finished++;
+}
+
+Json read_trace( const std::string & file_name )
+{
+	std::ifstream in( file_name );
+	const std::string text( ( std::istreambuf_iterator<char>( in ) ), std::istreambuf_iterator<char>() );
+
+	return JsonParser( text ).parse();
+}
+
+int main( int argc, char **argv )
+{
+	Tools::x_debug = new OutDebug();
+
+	try {
+		CoScheduler::ChromeTrace trace( "test \"scheduler\"" );
+		sch.set_tracer( &trace );
+
+		auto task_periodic = periodic();
+		auto task_waiter = waiter();
+
+		trace.set_task_name( &task_periodic, "periodic\ttask" );
+		trace.set_task_name( &task_waiter, "waiter" );
+		trace.set_object_name( flag, "flag" );
+
+		sch.add_task_reference( task_periodic );
+		sch.add_task_reference( task_waiter );
+
+		const auto start = std::chrono::steady_clock::now();
+
+		while( finished < 2 && std::chrono::steady_clock::now() - start < 5s ) {
+			if( !sch.schedule() ) {
+				sch.idle();
+			}
+		}
+
+		sch.set_tracer( nullptr );
+
+		check( finished == 2, "tasks finished" );
+
+		char file_name[] = "/tmp/test_chrome_traceXXXXXX";
+		const int fd = mkstemp( file_name );
+
+		if( fd < 0 ) {
+			throw std::system_error( errno, std::generic_category(), "mkstemp" );
+		}
+
+		close( fd );
+
+		trace.write_json( file_name );
+		const Json root = read_trace( file_name );
+		unlink( file_name );
+
+		const Json *events = root.get( "traceEvents" );
+		check( events && events->type == Json::Type::ARRAY, "traceEvents array" );
+
+		if( !events ) {
+			return result();
+		}
+
+		std::size_t slices = 0;
+		std::size_t periodic_slices = 0;
+		std::size_t negative = 0;
+		bool process_named = false;
+		bool waiter_named = false;
+		bool waited_for_flag = false;
+
+		for( const Json & event : events->items ) {
+			const std::string ph = event.get_string( "ph" );
+			const Json *args = event.get( "args" );
+
+			if( ph == "M" && event.get_string( "name" ) == "process_name" && args ) {
+				process_named = args->get_string( "name" ) == "test \"scheduler\"";
+			}
+
+			if( ph == "M" && event.get_string( "name" ) == "thread_name" && args && args->get_string( "name" ) == "waiter" ) {
+				waiter_named = true;
+			}
+
+			if( ph != "X" ) {
+				continue;
+			}
+
+			slices++;
+
+			if( event.get_string( "name" ) == "periodic\ttask" ) {
+				periodic_slices++;
+			}
+
+			for( const char *key : { "ts", "dur" } ) {
+				const Json *value = event.get( key );
+
+				if( !value || value->type != Json::Type::NUMBER || value->number < 0 ) {
+					negative++;
+				}
+			}
+
+			if( args ) {
+				if( const Json *next_run_in = args->get( "next_run_in_us" ) ) {
+					if( next_run_in->number < 0 ) {
+						negative++;
+					}
+				}
+
+				if( event.get_string( "name" ) == "waiter" && args->get_string( "waited_for" ) == "flag" &&
+					args->get_string( "wakeup" ) == "object" ) {
+					waited_for_flag = true;
+				}
+			}
+		}
+
+		check( process_named, "process name escaped and parsed again" );
+		check( waiter_named, "task track named" );
+		check( slices == trace.size(), format( "one slice per run: %d of %d", slices, trace.size() ) );
+		check( periodic_slices == 6, format( "periodic task resumed 6 times: %d", periodic_slices ) );
+		check( negative == 0, "no negative times" );
+		check( waited_for_flag, "waiter woken up by the named object" );
+
+		try {
+			trace.write_json( "/nonexistent/directory/trace.json" );
+			check( false, "writing into a missing directory throws" );
+		} catch( const std::runtime_error & error ) {
+			check( true, format( "writing into a missing directory throws: %s", error.what() ) );
+		}
+
+	} catch( const std::exception & error ) {
+		std::cout << "Error: " << error.what() << std::endl;
+		return 1;
+	}
+
+	return result();
+}
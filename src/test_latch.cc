@@ -0,0 +1,107 @@
+/**
+ * latch: count down past zero; barrier: reuse over several phases
+ * with participants of different speed
+ * @author Copyright (c) 2024 Martin Oberzalek
+ */
+#include <iostream>
+#include <OutDebug.h>
+#include <format.h>
+#include <chrono>
+#include <vector>
+#include "coscheduler/CoScheduler.hpp"
+#include "coscheduler/CoGenerator.hpp"
+#include "coscheduler/CoLatch.hpp"
+#include "CoSchedulerDynamicConf.h"
+#include "TestCheck.h"
+
+using namespace std::chrono_literals;
+using namespace Tools;
+using namespace TestCheck;
+
+using Scheduler = CoScheduler::Scheduler<DynamicConf>;
+using YIELD = CoScheduler::YIELD;
+
+static constexpr unsigned PARTICIPANTS = 3;
+static constexpr unsigned PHASES = 4;
+
+Scheduler sch;
+int finished = 0;
+
+CoScheduler::barrier phases( PARTICIPANTS );
+
+// phase each participant is in
+std::vector<unsigned> reached( PARTICIPANTS, 0 );
+int early_releases = 0;
+
+void test_latch()
+{
+	CoScheduler::latch done( 2 );
+
+	done.count_down();
+	check( !done.try_wait(), "latch not reached after one count down" );
+
+	done.count_down( 5 );
+	check( done.try_wait(), "latch reached, count down past zero" );
+
+	done.count_down();
+	check( done.try_wait(), "latch stays reached, no wrap around" );
+}
+
+Scheduler::yield_type participant( unsigned id, std::chrono::milliseconds work )
+{
+	for( unsigned phase = 0; phase < PHASES; phase++ ) {
+		if( work.count() ) {
+			co_yield YIELD( work );
+		}
+
+		co_yield YIELD( phases.arrive() );
+
+		// all participants have arrived for this phase
+		for( unsigned other = 0; other < PARTICIPANTS; other++ ) {
+			if( reached[other] < phase ) {
+				early_releases++;
+			}
+		}
+
+		reached[id] = phase + 1;
+	}
+
+	finished++;
+}
+
+int main( int argc, char **argv )
+{
+	Tools::x_debug = new OutDebug();
+
+	try {
+		test_latch();
+
+		// the fast one arrives for the next phase, before the
+		// slow ones have been resumed from the last phase
+		auto task_fast = participant( 0, 0ms );
+		auto task_medium = participant( 1, 2ms );
+		auto task_slow = participant( 2, 5ms );
+
+		sch.add_task_reference( task_fast );
+		sch.add_task_reference( task_medium );
+		sch.add_task_reference( task_slow );
+
+		const auto start = std::chrono::steady_clock::now();
+
+		while( finished < static_cast<int>( PARTICIPANTS ) && std::chrono::steady_clock::now() - start < 5s ) {
+			if( !sch.schedule() ) {
+				sch.idle();
+			}
+		}
+
+		check( finished == static_cast<int>( PARTICIPANTS ), "all participants finished" );
+		check( early_releases == 0, "nobody released before all participants arrived" );
+		check( phases.phase() == PHASES, format( "barrier in phase %d", phases.phase() ) );
+
+	} catch( const std::exception & error ) {
+		std::cout << "Error: " << error.what() << std::endl;
+		return 1;
+	}
+
+	return result();
+}
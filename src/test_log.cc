@@ -0,0 +1,116 @@
+/**
+ * AsyncLog: formatting of the captured arguments and overflow of the ring
+ * @author Copyright (c) 2024 Martin Oberzalek
+ */
+#include <iostream>
+#include <OutDebug.h>
+#include <format.h>
+#include <string>
+#include <vector>
+#include "coscheduler/CoScheduler.hpp"
+#include "coscheduler/CoLog.hpp"
+#include "TestCheck.h"
+
+using namespace Tools;
+using namespace TestCheck;
+
+// keeps the messages written by AsyncLog::drain()
+class CaptureDebug : public OutDebug
+{
+public:
+	bool capture = false;
+	std::vector<std::string> lines;
+
+	using OutDebug::add;
+
+	void add( const char *file, unsigned line, const char *function, const std::string & s ) override
+	{
+		if( capture ) {
+			lines.push_back( s );
+		} else {
+			OutDebug::add( file, line, function, s );
+		}
+	}
+};
+
+CaptureDebug *out = nullptr;
+
+std::vector<std::string> drain_lines( auto & log )
+{
+	out->lines.clear();
+	out->capture = true;
+	log.drain();
+	out->capture = false;
+
+	return out->lines;
+}
+
+void test_formatting()
+{
+	CoScheduler::AsyncLog<> log( CoScheduler::LogOverflow::DROP, []( CoScheduler::AsyncLog<>::clock::time_point ) {
+		return std::string( "T" );
+	});
+
+	const char *null_string = nullptr;
+	std::string long_string( 100, 'x' );
+
+	CO_DEBUG( log, "%s %d %s", "abc", 42, std::string( "xyz" ) );
+	CO_DEBUG( log, "null: %s", null_string );
+	CO_DEBUG( log, "%s", long_string );
+	CO_DEBUG( log, "at %s", CoScheduler::log_timestamp() );
+
+	const std::vector<std::string> lines = drain_lines( log );
+
+	check( lines.size() == 4, format( "%d messages written", lines.size() ) );
+
+	if( lines.size() == 4 ) {
+		check( lines[0] == "abc 42 xyz", "numbers and strings formatted: " + lines[0] );
+		check( lines[1] == "null: (null)", "null string formatted: " + lines[1] );
+		check( lines[2] == std::string( CoScheduler::LogDetail::MAX_STRING_LEN - 1, 'x' ), "long string truncated" );
+		check( lines[3] == "at T", "timestamp by the time formatter: " + lines[3] );
+	}
+}
+
+void test_overflow()
+{
+	static constexpr unsigned RING_SIZE = 8;
+	static constexpr unsigned MESSAGES = 20;
+
+	CoScheduler::AsyncLog<RING_SIZE> log;
+
+	for( unsigned i = 0; i < MESSAGES; i++ ) {
+		CO_DEBUG( log, "message %d", i );
+	}
+
+	std::vector<std::string> lines = drain_lines( log );
+
+	check( lines.size() > 1 && lines.size() <= RING_SIZE + 1, format( "%d lines after overflow", lines.size() ) );
+
+	if( lines.size() > 1 ) {
+		const std::string expected_drop = format( "%d log messages dropped", MESSAGES - ( lines.size() - 1 ) );
+		check( lines[0] == expected_drop, "lost messages reported: " + lines[0] );
+		check( lines[1] == "message 0", "oldest messages kept: " + lines[1] );
+	}
+
+	CO_DEBUG( log, "after drain" );
+	lines = drain_lines( log );
+
+	check( lines.size() == 1 && lines[0] == "after drain", "lost count reset, ring usable again" );
+}
+
+int main( int argc, char **argv )
+{
+	out = new CaptureDebug();
+	Tools::x_debug = out;
+
+	try {
+		test_formatting();
+		test_overflow();
+
+	} catch( const std::exception & error ) {
+		std::cout << "Error: " << error.what() << std::endl;
+		return 1;
+	}
+
+	return result();
+}
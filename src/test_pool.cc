@@ -0,0 +1,168 @@
+/**
+ * ThreadPool: results, a PoolJob destroyed while its job runs,
+ * and the shutdown of the pool while a task waits for a queued job
+ * @author Copyright (c) 2024 Martin Oberzalek
+ */
+#include <iostream>
+#include <OutDebug.h>
+#include <format.h>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <thread>
+#include "coscheduler/CoScheduler.hpp"
+#include "coscheduler/CoGenerator.hpp"
+#include "coscheduler/CoThreadPool.hpp"
+#include "CoSchedulerDynamicConf.h"
+#include "TestCheck.h"
+
+using namespace std::chrono_literals;
+using namespace Tools;
+using namespace TestCheck;
+
+using Scheduler = CoScheduler::Scheduler<DynamicConf>;
+using YIELD = CoScheduler::YIELD;
+
+Scheduler sch;
+int finished = 0;
+
+std::atomic<bool> gate = false;
+std::atomic<bool> blocker_running = false;
+std::atomic<int>  blocker_runs = 0;
+
+void wait_for_gate()
+{
+	blocker_running = true;
+
+	while( !gate ) {
+		std::this_thread::sleep_for( 1ms );
+	}
+
+	blocker_runs++;
+}
+
+template<class Predicate> bool schedule_until( Predicate predicate )
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	while( !predicate() ) {
+		if( std::chrono::steady_clock::now() - start > 5s ) {
+			return false;
+		}
+
+		sch.schedule();
+	}
+
+	return true;
+}
+
+Scheduler::yield_type compute( CoScheduler::ThreadPool & pool )
+{
+	auto job = CoScheduler::run_on_pool( pool, sch, []() {
+		return 6 * 7;
+	});
+
+	co_yield YIELD( job );
+
+	check( job.get() == 42, "result of the job" );
+	finished++;
+}
+
+/*
+ * gives up waiting, the PoolJob is destroyed, while the worker still runs the job
+ */
+Scheduler::yield_type give_up( CoScheduler::ThreadPool & pool )
+{
+	{
+		auto job = CoScheduler::run_on_pool( pool, sch, []() {
+			wait_for_gate();
+			return std::make_unique<int>( 1 );
+		});
+
+		const YIELD & r = co_yield YIELD( job, 20ms );
+
+		check( r.timed_out(), "job still running after the timeout" );
+	}
+
+	finished++;
+}
+
+/*
+ * the second job is still queued, when the pool is destroyed
+ */
+Scheduler::yield_type wait_for_queued( CoScheduler::ThreadPool & pool )
+{
+	auto running = CoScheduler::run_on_pool( pool, sch, []() {
+		wait_for_gate();
+	});
+
+	auto queued = CoScheduler::run_on_pool( pool, sch, []() {
+		return 1;
+	});
+
+	co_yield YIELD( queued );
+
+	check( running.done() && !running.was_dropped(), "running job finished on shutdown" );
+	check( queued.was_dropped(), "queued job dropped on shutdown" );
+
+	try {
+		queued.get();
+		check( false, "get() of a dropped job throws" );
+	} catch( const std::future_error & error ) {
+		check( error.code() == std::future_errc::broken_promise, "get() of a dropped job throws broken_promise" );
+	}
+
+	finished++;
+}
+
+int main( int argc, char **argv )
+{
+	Tools::x_debug = new OutDebug();
+
+	try {
+		{
+			CoScheduler::ThreadPool pool( 2 );
+
+			auto task_compute = compute( pool );
+			auto task_give_up = give_up( pool );
+			sch.add_task_reference( task_compute );
+			sch.add_task_reference( task_give_up );
+
+			check( schedule_until( []() { return finished == 2; } ), "tasks finished, job still running" );
+			check( blocker_runs == 0, "abandoned job still blocked" );
+
+			gate = true;
+		}
+
+		check( blocker_runs == 1, "abandoned job finished by the worker" );
+
+		gate = false;
+		blocker_running = false;
+		finished = 0;
+
+		auto pool = std::make_unique<CoScheduler::ThreadPool>( 1 );
+
+		auto task_queued = wait_for_queued( *pool );
+		sch.add_task_reference( task_queued );
+
+		check( schedule_until( []() { return blocker_running.load(); } ), "first job started" );
+
+		std::thread opener( []() {
+			std::this_thread::sleep_for( 20ms );
+			gate = true;
+		});
+
+		// waits for the running job, drops the queued one
+		pool.reset();
+		opener.join();
+
+		check( schedule_until( []() { return finished == 1; } ), "waiting task woken up by the shutdown" );
+
+	} catch( const std::exception & error ) {
+		std::cout << "Error: " << error.what() << std::endl;
+		return 1;
+	}
+
+	return result();
+}
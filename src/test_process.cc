@@ -0,0 +1,121 @@
+/**
+ * ProcessExit: exit status of a child, timeout and kill of a child
+ * @author Copyright (c) 2024 Martin Oberzalek
+ */
+#include <iostream>
+#include <OutDebug.h>
+#include <format.h>
+#include <chrono>
+#include <vector>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "coscheduler/CoScheduler.hpp"
+#include "coscheduler/CoGenerator.hpp"
+#include "coscheduler/CoReactor.hpp"
+#include "coscheduler/CoProcess.hpp"
+#include "TestCheck.h"
+
+using namespace std::chrono_literals;
+using namespace Tools;
+using namespace TestCheck;
+
+struct ReactorConf
+{
+	using yield_type = CoScheduler::CoGenerator<CoScheduler::YIELD>;
+
+	using CONTAINER_TASKS            = std::vector<yield_type*>;
+	using CONTAINER_WAITABLE_OBJECTS = std::vector<CoScheduler::WaitForBase*>;
+	using CONTAINER_WAIT_OBJECTS     = std::vector<CoScheduler::WaitForBase*>;
+
+	using IDLE_WAITER = CoScheduler::Reactor;
+
+	inline static void idle( IDLE_WAITER & waiter, std::chrono::nanoseconds timeout )
+	{
+		waiter.wait_for( timeout );
+	}
+};
+
+using Scheduler = CoScheduler::Scheduler<ReactorConf>;
+using YIELD = CoScheduler::YIELD;
+
+Scheduler sch;
+int finished = 0;
+
+pid_t start_child( int exit_code, std::chrono::milliseconds runtime )
+{
+	const pid_t pid = fork();
+
+	if( pid < 0 ) {
+		throw std::system_error( errno, std::generic_category(), "fork" );
+	}
+
+	if( pid == 0 ) {
+		usleep( std::chrono::duration_cast<std::chrono::microseconds>( runtime ).count() );
+		_exit( exit_code );
+	}
+
+	return pid;
+}
+
+Scheduler::yield_type wait_exit()
+{
+	CoScheduler::ProcessExit child( sch.get_idle_waiter(), start_child( 3, 10ms ) );
+
+	const YIELD & r = co_yield YIELD( child, 5s );
+
+	check( !r.timed_out() && child.has_exited(), "child exited" );
+	check( WIFEXITED( child.status() ) && WEXITSTATUS( child.status() ) == 3,
+		   format( "exit status 3 (status %d)", child.status() ) );
+
+	finished++;
+}
+
+Scheduler::yield_type kill_hanging()
+{
+	CoScheduler::ProcessExit child( sch.get_idle_waiter(), start_child( 0, 10s ) );
+
+	const YIELD & r = co_yield YIELD( child, 20ms );
+
+	check( r.timed_out(), "hanging child timed out" );
+	check( child.send_signal( SIGKILL ) == 0, "SIGKILL sent via the pidfd" );
+
+	co_yield YIELD( child );
+
+	check( WIFSIGNALED( child.status() ) && WTERMSIG( child.status() ) == SIGKILL,
+		   format( "killed by SIGKILL (status %d)", child.status() ) );
+
+	// reaped already
+	check( waitpid( child.get_pid(), nullptr, WNOHANG ) < 0 && errno == ECHILD, "child reaped" );
+
+	finished++;
+}
+
+int main( int argc, char **argv )
+{
+	Tools::x_debug = new OutDebug();
+
+	try {
+		auto task_exit = wait_exit();
+		auto task_kill = kill_hanging();
+
+		sch.add_task_reference( task_exit );
+		sch.add_task_reference( task_kill );
+
+		const auto start = std::chrono::steady_clock::now();
+
+		while( finished < 2 && std::chrono::steady_clock::now() - start < 5s ) {
+			if( !sch.schedule() ) {
+				sch.idle();
+			}
+		}
+
+		check( finished == 2, "all tasks finished" );
+
+	} catch( const std::exception & error ) {
+		std::cout << "Error: " << error.what() << std::endl;
+		return 1;
+	}
+
+	return result();
+}
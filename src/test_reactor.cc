@@ -0,0 +1,212 @@
+/**
+ * Reactor as idle waiter: waiting for a pipe to get readable
+ * or writable, the scheduler is woken up by epoll, not by MAX_IDLE
+ * @author Copyright (c) 2024 Martin Oberzalek
+ */
+#include <iostream>
+#include <OutDebug.h>
+#include <format.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "coscheduler/CoScheduler.hpp"
+#include "coscheduler/CoGenerator.hpp"
+#include "coscheduler/CoReactor.hpp"
+#include "TestCheck.h"
+
+using namespace std::chrono_literals;
+using namespace Tools;
+using namespace TestCheck;
+
+struct ReactorConf
+{
+	using yield_type = CoScheduler::CoGenerator<CoScheduler::YIELD>;
+
+	using CONTAINER_TASKS            = std::vector<yield_type*>;
+	using CONTAINER_WAITABLE_OBJECTS = std::vector<CoScheduler::WaitForBase*>;
+	using CONTAINER_WAIT_OBJECTS     = std::vector<CoScheduler::WaitForBase*>;
+
+	using IDLE_WAITER = CoScheduler::Reactor;
+
+	// all objects are changed by fd events
+	static constexpr std::chrono::nanoseconds MAX_IDLE = 1s;
+
+	inline static void idle( IDLE_WAITER & waiter, std::chrono::nanoseconds timeout )
+	{
+		waiter.wait_for( timeout );
+	}
+};
+
+using Scheduler = CoScheduler::Scheduler<ReactorConf>;
+using YIELD = CoScheduler::YIELD;
+
+Scheduler sch;
+int finished = 0;
+
+class Pipe
+{
+public:
+	int fds[2] = { -1, -1 };
+
+	Pipe() {
+		if( pipe2( fds, O_NONBLOCK | O_CLOEXEC ) != 0 ) {
+			throw std::system_error( errno, std::generic_category(), "pipe2" );
+		}
+	}
+
+	~Pipe() {
+		close( fds[0] );
+		close( fds[1] );
+	}
+
+	int read_end() const {
+		return fds[0];
+	}
+
+	int write_end() const {
+		return fds[1];
+	}
+};
+
+Scheduler::yield_type receive( CoScheduler::FdWaiter & in, std::string & received, std::chrono::steady_clock::duration & woken_up )
+{
+	char buffer[64];
+
+	while( true ) {
+		const ssize_t len = read( in.get_fd(), buffer, sizeof(buffer) );
+
+		if( len < 0 && errno == EAGAIN ) {
+			co_yield YIELD( in.readable() );
+
+			// by the data, the end of the pipe follows later
+			if( woken_up.count() == 0 ) {
+				woken_up = std::chrono::steady_clock::now().time_since_epoch();
+			}
+			continue;
+		}
+
+		if( len <= 0 ) {
+			break;
+		}
+
+		received.append( buffer, static_cast<std::size_t>( len ) );
+	}
+
+	finished++;
+}
+
+Scheduler::yield_type fill( CoScheduler::FdWaiter & out, std::size_t & written, std::size_t total )
+{
+	const std::vector<char> block( 4096, 'x' );
+
+	while( written < total ) {
+		const ssize_t len = write( out.get_fd(), block.data(), std::min( block.size(), total - written ) );
+
+		if( len < 0 && errno == EAGAIN ) {
+			co_yield YIELD( out.writable() );
+			continue;
+		}
+
+		if( len < 0 ) {
+			break;
+		}
+
+		written += static_cast<std::size_t>( len );
+	}
+
+	finished++;
+}
+
+int main( int argc, char **argv )
+{
+	Tools::x_debug = new OutDebug();
+
+	try {
+		// readable
+		{
+			Pipe pipe;
+			CoScheduler::FdWaiter in( sch.get_idle_waiter(), pipe.read_end() );
+			std::string received;
+			std::chrono::steady_clock::duration woken_up{};
+			std::chrono::steady_clock::duration sent{};
+
+			auto task_receive = receive( in, received, woken_up );
+			sch.add_task_reference( task_receive );
+
+			std::thread sender( [&pipe,&sent]() {
+				std::this_thread::sleep_for( 20ms );
+				sent = std::chrono::steady_clock::now().time_since_epoch();
+				[[maybe_unused]] auto ret = write( pipe.write_end(), "hello", 5 );
+
+				std::this_thread::sleep_for( 20ms );
+				close( pipe.fds[1] );
+				pipe.fds[1] = -1;
+			});
+
+			const auto start = std::chrono::steady_clock::now();
+
+			while( finished < 1 && std::chrono::steady_clock::now() - start < 5s ) {
+				if( !sch.schedule() ) {
+					sch.idle();
+				}
+			}
+
+			sender.join();
+
+			check( finished == 1, "receiver finished at the end of the pipe" );
+			check( received == "hello", "data received" );
+			check( woken_up - sent < 100ms, format( "woken up %dus after the write",
+													std::chrono::duration_cast<std::chrono::microseconds>( woken_up - sent ).count() ) );
+		}
+
+		// writable
+		{
+			static constexpr std::size_t TOTAL = 1024 * 1024;
+
+			Pipe pipe;
+			CoScheduler::FdWaiter out( sch.get_idle_waiter(), pipe.write_end() );
+			std::size_t written = 0;
+			std::size_t drained = 0;
+
+			auto task_fill = fill( out, written, TOTAL );
+			sch.add_task_reference( task_fill );
+
+			std::thread drainer( [&pipe,&drained]() {
+				char buffer[4096];
+				const auto deadline = std::chrono::steady_clock::now() + 5s;
+
+				while( drained < TOTAL && std::chrono::steady_clock::now() < deadline ) {
+					const ssize_t len = read( pipe.read_end(), buffer, sizeof(buffer) );
+
+					if( len > 0 ) {
+						drained += static_cast<std::size_t>( len );
+					} else {
+						std::this_thread::sleep_for( 1ms );
+					}
+				}
+			});
+
+			const auto start = std::chrono::steady_clock::now();
+
+			while( finished < 2 && std::chrono::steady_clock::now() - start < 5s ) {
+				if( !sch.schedule() ) {
+					sch.idle();
+				}
+			}
+
+			drainer.join();
+
+			check( finished == 2 && written == TOTAL, format( "%d bytes written into a full pipe", written ) );
+			check( std::chrono::steady_clock::now() - start < 1s, "writer woken up by the fd, not by MAX_IDLE" );
+		}
+
+	} catch( const std::exception & error ) {
+		std::cout << "Error: " << error.what() << std::endl;
+		return 1;
+	}
+
+	return result();
+}
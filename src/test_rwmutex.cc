@@ -0,0 +1,152 @@
+/**
+ * rw_mutex: reader batch while a writer waits, writers giving up
+ * @author Copyright (c) 2024 Martin Oberzalek
+ */
+#include <iostream>
+#include <OutDebug.h>
+#include <format.h>
+#include <chrono>
+#include "coscheduler/CoScheduler.hpp"
+#include "coscheduler/CoGenerator.hpp"
+#include "coscheduler/CoRwMutex.hpp"
+#include "CoSchedulerDynamicConf.h"
+#include "TestCheck.h"
+
+using namespace std::chrono_literals;
+using namespace Tools;
+using namespace TestCheck;
+
+using Scheduler = CoScheduler::Scheduler<DynamicConf>;
+using YIELD = CoScheduler::YIELD;
+
+Scheduler sch;
+int finished = 0;
+
+void test_batch()
+{
+	CoScheduler::rw_mutex m( 2 );
+
+	check( m.try_lock_shared(), "first reader" );
+
+	{
+		auto writer = m.exclusive();
+		check( !writer.try_lock(), "writer waits for the reader" );
+
+		check( m.try_lock_shared() && m.try_lock_shared(), "two more readers within the batch" );
+		check( !m.try_lock_shared(), "batch exhausted, reader has to wait" );
+
+		// the writer gives up
+	}
+
+	check( m.try_lock_shared(), "no writer waiting, readers get in" );
+
+	{
+		auto writer = m.exclusive();
+		check( !writer.try_lock(), "next writer waits" );
+
+		check( m.try_lock_shared() && m.try_lock_shared(), "new batch for the next writer" );
+		check( !m.try_lock_shared(), "batch exhausted again" );
+
+		// all six readers of this test
+		for( int i = 0; i < 6; i++ ) {
+			m.unlock_shared();
+		}
+
+		check( writer.try_lock(), "writer gets the lock after the readers" );
+		check( !m.try_lock_shared(), "no reader while the writer holds the lock" );
+		m.unlock();
+	}
+
+	check( m.try_lock_shared(), "reader after the writer" );
+	m.unlock_shared();
+}
+
+CoScheduler::rw_mutex rw( 1 );
+
+Scheduler::yield_type reader( std::chrono::milliseconds hold )
+{
+	auto lock = rw.shared();
+
+	while( !lock.try_lock() ) {
+		co_yield YIELD( lock );
+	}
+
+	co_yield YIELD( hold );
+
+	rw.unlock_shared();
+	finished++;
+}
+
+Scheduler::yield_type impatient_writer()
+{
+	{
+		auto lock = rw.exclusive();
+
+		while( !lock.try_lock() ) {
+			const YIELD & r = co_yield YIELD( lock, 10ms );
+
+			if( r.timed_out() ) {
+				break;
+			}
+		}
+
+		check( !rw.can_lock(), "writer gave up, readers still hold the lock" );
+	}
+
+	finished++;
+}
+
+Scheduler::yield_type late_writer()
+{
+	co_yield YIELD( 20ms );
+
+	auto lock = rw.exclusive();
+
+	check( !lock.try_lock(), "late writer has to wait" );
+
+	// the batch has been reset, one more reader may still overtake
+	check( rw.try_lock_shared(), "reader overtakes the late writer" );
+	rw.unlock_shared();
+
+	while( !lock.try_lock() ) {
+		co_yield YIELD( lock );
+	}
+
+	rw.unlock();
+	finished++;
+}
+
+int main( int argc, char **argv )
+{
+	Tools::x_debug = new OutDebug();
+
+	try {
+		test_batch();
+
+		auto task_reader1 = reader( 50ms );
+		auto task_writer = impatient_writer();
+		auto task_reader2 = reader( 50ms );
+		auto task_late = late_writer();
+
+		sch.add_task_reference( task_reader1 );
+		sch.add_task_reference( task_writer );
+		sch.add_task_reference( task_reader2 );
+		sch.add_task_reference( task_late );
+
+		const auto start = std::chrono::steady_clock::now();
+
+		while( finished < 4 && std::chrono::steady_clock::now() - start < 5s ) {
+			if( !sch.schedule() ) {
+				sch.idle();
+			}
+		}
+
+		check( finished == 4, "all tasks finished" );
+
+	} catch( const std::exception & error ) {
+		std::cout << "Error: " << error.what() << std::endl;
+		return 1;
+	}
+
+	return result();
+}
@@ -0,0 +1,192 @@
+/**
+ * Child tasks bound to a TaskScope
+ * @author Copyright (c) 2024 Martin Oberzalek
+ */
+#include <iostream>
+#include <OutDebug.h>
+#include <format.h>
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <vector>
+#include "coscheduler/CoScheduler.hpp"
+#include "coscheduler/CoGenerator.hpp"
+#include "coscheduler/CoTaskScope.hpp"
+#include "CoSchedulerDynamicConf.h"
+#include "TestCheck.h"
+
+using namespace std::chrono_literals;
+using namespace Tools;
+using namespace TestCheck;
+
+using Scheduler = CoScheduler::Scheduler<DynamicConf>;
+using YIELD = CoScheduler::YIELD;
+
+Scheduler sch;
+
+int finished = 0;
+int cancelled = 0;
+int destroyed = 0;
+
+struct CountDestroy
+{
+	~CountDestroy() {
+		destroyed++;
+	}
+};
+
+Scheduler::yield_type worker( int i )
+{
+	for( int k = 0; k < 3; k++ ) {
+		co_yield YIELD( std::chrono::milliseconds( i ) );
+	}
+
+	finished++;
+}
+
+Scheduler::yield_type sleeper()
+{
+	CountDestroy count_destroy;
+
+	const YIELD & result = co_yield YIELD( 10s );
+
+	if( result.cancelled() ) {
+		cancelled++;
+	}
+}
+
+// records, where its frame has been allocated
+Scheduler::yield_type framed( std::vector<const void*> & frames )
+{
+	int in_frame = 0;
+	frames.push_back( &in_frame );
+
+	co_yield YIELD( 1ms );
+
+	in_frame++;
+}
+
+Scheduler::yield_type thrower()
+{
+	co_yield YIELD( 5ms );
+	throw std::runtime_error( "failed" );
+}
+
+Scheduler::yield_type test()
+{
+	{
+		CoScheduler::TaskScope<Scheduler> scope( sch );
+
+		for( int i = 1; i <= 5; i++ ) {
+			scope.spawn( [i]() {
+				return worker( i );
+			});
+		}
+
+		co_yield YIELD( scope.join() );
+
+		check( finished == 5, format( "join() waits for all children: %d", finished ) );
+		check( !scope.failed(), "no child failed" );
+	}
+
+	{
+		CoScheduler::TaskScope<Scheduler> scope( sch );
+
+		for( int i = 0; i < 4; i++ ) {
+			scope.spawn( []() {
+				return sleeper();
+			});
+		}
+
+		scope.spawn( []() {
+			return thrower();
+		});
+
+		const auto start = std::chrono::steady_clock::now();
+
+		co_yield YIELD( scope.join() );
+
+		check( scope.failed(), "the exception of a child is stored" );
+		check( cancelled == 4, format( "the other children are cancelled: %d", cancelled ) );
+		check( std::chrono::steady_clock::now() - start < 5s, "cancelled children don't wait for their timeout" );
+
+		try {
+			scope.rethrow_if_failed();
+			check( false, "rethrow_if_failed() throws" );
+		} catch( const std::runtime_error & error ) {
+			check( std::string( error.what() ) == "failed", format( "the exception is rethrown: %s", error.what() ) );
+		}
+	}
+
+	destroyed = 0;
+
+	{
+		CoScheduler::TaskScope<Scheduler> scope( sch );
+
+		for( int i = 0; i < 4; i++ ) {
+			scope.spawn( []() {
+				return sleeper();
+			});
+		}
+
+		co_yield YIELD( 1ms );
+	}
+
+	check( destroyed == 4, format( "unfinished children are destroyed with the scope: %d", destroyed ) );
+
+	{
+		CoScheduler::TaskScope<Scheduler> scope( sch );
+		std::vector<const void*> first_wave;
+		std::vector<const void*> second_wave;
+		std::vector<const void*> overlapping;
+
+		for( int i = 0; i < 3; i++ ) {
+			scope.spawn( [&first_wave]() {
+				return framed( first_wave );
+			});
+		}
+
+		co_yield YIELD( scope.join() );
+
+		for( int i = 0; i < 3; i++ ) {
+			scope.spawn( [&second_wave]() {
+				return framed( second_wave );
+			});
+		}
+
+		// the children run till their first co_yield
+		co_yield YIELD( 0ms );
+
+		check( second_wave == first_wave, "arena reused, after all children finished" );
+
+		// the second wave is still running
+		scope.spawn( [&overlapping]() {
+			return framed( overlapping );
+		});
+
+		co_yield YIELD( scope.join() );
+
+		check( overlapping.size() == 1 &&
+			   std::find( second_wave.begin(), second_wave.end(), overlapping.front() ) == second_wave.end(),
+			   "arena not reused, while children are running" );
+	}
+
+	sch.stop();
+}
+
+int main( int argc, char **argv )
+{
+	Tools::x_debug = new OutDebug();
+
+	try {
+		sch.spawn( test() );
+
+		sch.infinite_schedule();
+
+	} catch( const std::exception & error ) {
+		std::cout << "Error: " << error.what() << std::endl;
+		return 1;
+	}
+
+	return result();
+}
@@ -0,0 +1,127 @@
+/**
+ * SignalWaiter: receiving signals up to SIGRTMAX, restoring the
+ * signal mask, and stopping the scheduler more than once
+ * @author Copyright (c) 2024 Martin Oberzalek
+ */
+#include <iostream>
+#include <OutDebug.h>
+#include <format.h>
+#include <chrono>
+#include <vector>
+#include <signal.h>
+#include <unistd.h>
+#include "coscheduler/CoScheduler.hpp"
+#include "coscheduler/CoGenerator.hpp"
+#include "coscheduler/CoReactor.hpp"
+#include "coscheduler/CoSignal.hpp"
+#include "TestCheck.h"
+
+using namespace std::chrono_literals;
+using namespace Tools;
+using namespace TestCheck;
+
+struct ReactorConf
+{
+	using yield_type = CoScheduler::CoGenerator<CoScheduler::YIELD>;
+
+	using CONTAINER_TASKS            = std::vector<yield_type*>;
+	using CONTAINER_WAITABLE_OBJECTS = std::vector<CoScheduler::WaitForBase*>;
+	using CONTAINER_WAIT_OBJECTS     = std::vector<CoScheduler::WaitForBase*>;
+
+	using IDLE_WAITER = CoScheduler::Reactor;
+
+	inline static void idle( IDLE_WAITER & waiter, std::chrono::nanoseconds timeout )
+	{
+		waiter.wait_for( timeout );
+	}
+};
+
+using Scheduler = CoScheduler::Scheduler<ReactorConf>;
+using YIELD = CoScheduler::YIELD;
+
+Scheduler sch;
+
+bool is_blocked( int sig )
+{
+	sigset_t mask;
+	pthread_sigmask( SIG_BLOCK, nullptr, &mask );
+	return sigismember( &mask, sig );
+}
+
+Scheduler::yield_type receive( CoScheduler::SignalWaiter & signals, std::vector<int> & received )
+{
+	while( received.size() < 2 ) {
+		co_yield YIELD( signals );
+
+		while( int sig = signals.pop_signal() ) {
+			received.push_back( sig );
+		}
+	}
+
+	sch.stop();
+}
+
+Scheduler::yield_type stop_later()
+{
+	co_yield YIELD( 10ms );
+	sch.stop();
+}
+
+int main( int argc, char **argv )
+{
+	Tools::x_debug = new OutDebug();
+
+	try {
+		// already blocked before, has to stay blocked
+		sigset_t usr2;
+		sigemptyset( &usr2 );
+		sigaddset( &usr2, SIGUSR2 );
+		pthread_sigmask( SIG_BLOCK, &usr2, nullptr );
+
+		std::vector<int> received;
+
+		{
+			CoScheduler::SignalWaiter signals( sch.get_idle_waiter(), { SIGUSR1, SIGUSR2, SIGRTMAX } );
+
+			check( is_blocked( SIGUSR1 ) && is_blocked( SIGRTMAX ), "signals blocked" );
+
+			auto task_receive = receive( signals, received );
+			sch.add_task_reference( task_receive );
+
+			kill( getpid(), SIGRTMAX );
+			kill( getpid(), SIGUSR1 );
+
+			sch.infinite_schedule();
+
+			check( received.size() == 2 && received[0] == SIGUSR1 && received[1] == SIGRTMAX,
+				   format( "received SIGUSR1 and SIGRTMAX (%d)", SIGRTMAX ) );
+
+			// pending on destruction, dropped instead of being delivered
+			kill( getpid(), SIGUSR1 );
+		}
+
+		check( !is_blocked( SIGUSR1 ), "SIGUSR1 unblocked again" );
+		check( !is_blocked( SIGRTMAX ), "SIGRTMAX unblocked again" );
+		check( is_blocked( SIGUSR2 ), "SIGUSR2 still blocked, as before" );
+
+		check( !sch.is_stopping(), "stop request reset by infinite_schedule()" );
+
+		auto task_stop = stop_later();
+		sch.add_task_reference( task_stop );
+
+		const auto start = std::chrono::steady_clock::now();
+		sch.infinite_schedule();
+
+		check( std::chrono::steady_clock::now() - start >= 10ms, "second infinite_schedule() ran till the next stop()" );
+
+		sch.stop();
+		sch.reset_stop();
+		check( !sch.is_stopping(), "reset_stop() withdraws the stop request" );
+
+	} catch( const std::exception & error ) {
+		std::cout << "Error: " << error.what() << std::endl;
+		return 1;
+	}
+
+	return result();
+}
@@ -0,0 +1,123 @@
+/**
+ * Spawned and caller owned tasks, with frames recycled by the FramePool
+ * @author Copyright (c) 2024 Martin Oberzalek
+ */
+#include <iostream>
+#include <OutDebug.h>
+#include <format.h>
+#include <chrono>
+#include <set>
+#include "coscheduler/CoScheduler.hpp"
+#include "coscheduler/CoGenerator.hpp"
+#include "CoSchedulerDynamicConf.h"
+#include "TestCheck.h"
+
+using namespace std::chrono_literals;
+using namespace Tools;
+using namespace TestCheck;
+
+using Scheduler = CoScheduler::Scheduler<DynamicConf>;
+using YIELD = CoScheduler::YIELD;
+
+static constexpr int ROUNDS = 1000;
+static constexpr int TASKS_PER_ROUND = 10;
+
+Scheduler sch;
+
+/*
+ * Frames of the tasks, that are not finished yet. A frame, that is
+ * destroyed twice, lands twice in the free list of the pool, so two
+ * live tasks would get the same frame.
+ */
+std::set<void*> live_frames;
+std::set<void*> used_frames;
+void *frames[ROUNDS * TASKS_PER_ROUND + ROUNDS] = {};
+int finished = 0;
+bool shared_frame = false;
+
+Scheduler::yield_type request( int id )
+{
+	co_yield YIELD();
+	co_yield YIELD( std::chrono::microseconds( id % 7 ) );
+
+	live_frames.erase( frames[id] );
+	finished++;
+}
+
+void track( Scheduler::yield_type & task, int id )
+{
+	frames[id] = task.get_handle().address();
+
+	if( !live_frames.insert( frames[id] ).second ) {
+		shared_frame = true;
+	}
+
+	used_frames.insert( frames[id] );
+}
+
+Scheduler::yield_type spawner()
+{
+	int id = 0;
+
+	for( int round = 0; round < ROUNDS; round++ ) {
+
+		// finishes while the scheduler holds a reference, the frame
+		// has to be destroyed once, by the generator
+		{
+			auto owned = request( id );
+			void *frame = owned.get_handle().address();
+			track( owned, id++ );
+			sch.add_task_reference( owned );
+
+			while( live_frames.count( frame ) ) {
+				co_yield YIELD();
+			}
+		}
+
+		for( int i = 0; i < TASKS_PER_ROUND; i++ ) {
+			auto task = request( id );
+			track( task, id++ );
+			sch.spawn( std::move( task ) );
+		}
+
+		co_yield YIELD();
+	}
+
+	while( finished < id ) {
+		co_yield YIELD( 1ms );
+	}
+
+	sch.stop();
+}
+
+// still running, when the scheduler stops, destroyed by ~Scheduler()
+Scheduler::yield_type forever()
+{
+	while( true ) {
+		co_yield YIELD( 1s );
+	}
+}
+
+int main( int argc, char **argv )
+{
+	Tools::x_debug = new OutDebug();
+
+	try {
+		auto task_spawner = spawner();
+		sch.add_task_reference( task_spawner );
+		sch.spawn( forever() );
+
+		sch.infinite_schedule();
+
+		check( finished == ROUNDS * ( TASKS_PER_ROUND + 1 ), format( "all tasks finished: %d", finished ) );
+		check( !shared_frame, "no frame is used by two live tasks" );
+		check( live_frames.empty(), "no frames left" );
+		check( used_frames.size() < 100, format( "frames are recycled: %d distinct frames", used_frames.size() ) );
+
+	} catch( const std::exception & error ) {
+		std::cout << "Error: " << error.what() << std::endl;
+		return 1;
+	}
+
+	return result();
+}
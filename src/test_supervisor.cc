@@ -0,0 +1,118 @@
+/**
+ * Restarting of failed tasks with the Supervisor, and fault isolation
+ * @author Copyright (c) 2024 Martin Oberzalek
+ */
+#include <iostream>
+#include <OutDebug.h>
+#include <format.h>
+#include <chrono>
+#include <stdexcept>
+#include "coscheduler/CoScheduler.hpp"
+#include "coscheduler/CoGenerator.hpp"
+#include "coscheduler/CoSupervisor.hpp"
+#include "CoSchedulerDynamicConf.h"
+#include "TestCheck.h"
+
+using namespace std::chrono_literals;
+using namespace Tools;
+using namespace TestCheck;
+
+using YIELD = CoScheduler::YIELD;
+
+class TestScheduler : public CoScheduler::Scheduler<DynamicConf>
+{
+public:
+	int failed = 0;
+
+protected:
+	void on_task_failed( yield_type & task, const CoScheduler::TaskFailure & failure ) override
+	{
+		failed++;
+		CoScheduler::Scheduler<DynamicConf>::on_task_failed( task, failure );
+	}
+};
+
+using Supervisor = CoScheduler::Supervisor<TestScheduler>;
+
+TestScheduler sch;
+
+int attempts = 0;
+int ticks = 0;
+
+// fails twice, then finishes
+TestScheduler::yield_type flaky()
+{
+	attempts++;
+	co_yield YIELD( 1ms );
+
+	if( attempts < 3 ) {
+		throw std::runtime_error( "flaky" );
+	}
+}
+
+TestScheduler::yield_type always_failing()
+{
+	co_yield YIELD( 1ms );
+	throw 42;
+}
+
+// not supervised, isolated by the scheduler
+TestScheduler::yield_type unsupervised()
+{
+	co_yield YIELD( 1ms );
+	throw std::logic_error( "unsupervised" );
+}
+
+// the other tasks keep running
+TestScheduler::yield_type ticker()
+{
+	for( int i = 0; i < 100; i++ ) {
+		co_yield YIELD( 2ms );
+		ticks++;
+	}
+
+	sch.stop();
+}
+
+int main( int argc, char **argv )
+{
+	Tools::x_debug = new OutDebug();
+
+	try {
+		sch.set_fault_isolation( true );
+
+		Supervisor supervisor( sch );
+		CoScheduler::RestartPolicy policy;
+		policy.initial_backoff = 5ms;
+		policy.max_restarts = 3;
+
+		auto & child_flaky = supervisor.supervise( "flaky", []() {
+			return flaky();
+		}, policy );
+
+		auto & child_failing = supervisor.supervise( "failing", []() {
+			return always_failing();
+		}, policy );
+
+		sch.spawn( unsupervised() );
+		sch.spawn( ticker() );
+
+		sch.infinite_schedule();
+
+		check( child_flaky.get_state() == Supervisor::State::FINISHED, "flaky task finished after restarts" );
+		check( attempts == 3, format( "flaky task started 3 times: %d", attempts ) );
+		check( child_flaky.get_failures() == 2, format( "flaky task failed twice: %d", child_flaky.get_failures() ) );
+		check( child_failing.get_state() == Supervisor::State::PARKED, "failing task is parked" );
+		check( child_failing.get_failures() == policy.max_restarts + 1,
+			   format( "failing task failed max_restarts + 1 times: %d", child_failing.get_failures() ) );
+		check( Supervisor::describe( child_failing.get_last_failure() ) == "unknown exception", "failure is described" );
+		check( sch.failed == 1, format( "unsupervised failure reaches on_task_failed(): %d", sch.failed ) );
+		check( ticks == 100, format( "other tasks keep running: %d", ticks ) );
+
+	} catch( const std::exception & error ) {
+		std::cout << "Error: " << error.what() << std::endl;
+		return 1;
+	}
+
+	return result();
+}
@@ -0,0 +1,124 @@
+/**
+ * YIELD on a wait object with timeout: wakeup reason TIMEOUT or OBJECT
+ * @author Copyright (c) 2024 Martin Oberzalek
+ */
+#include <iostream>
+#include <OutDebug.h>
+#include <format.h>
+#include <chrono>
+#include <thread>
+#include "coscheduler/CoScheduler.hpp"
+#include "coscheduler/CoGenerator.hpp"
+#include "CoSchedulerDynamicConf.h"
+#include "TestCheck.h"
+
+using namespace std::chrono_literals;
+using namespace Tools;
+using namespace TestCheck;
+
+using Scheduler = CoScheduler::Scheduler<DynamicConf>;
+using YIELD = CoScheduler::YIELD;
+
+class Flag : public CoScheduler::WaitForBase
+{
+public:
+	bool set = false;
+
+	bool condition_reached() const override {
+		return set;
+	}
+};
+
+Scheduler sch;
+Flag flag;
+int step = 0;
+
+Scheduler::yield_type waiter()
+{
+	// nobody sets the flag
+	auto start = std::chrono::steady_clock::now();
+
+	if( (co_yield YIELD( flag, 10ms )).timed_out() ) {
+		check( std::chrono::steady_clock::now() - start >= 10ms, "timed out, not before the timeout" );
+	} else {
+		check( false, "timed out" );
+	}
+
+	step = 1;
+
+	// set by the main loop within the timeout
+	{
+		const YIELD & r = co_yield YIELD( flag, 1s );
+
+		check( r.wakeup_reason == YIELD::WakeupReason::OBJECT, "woken up by the object" );
+		check( !r.timed_out(), "no timeout, when the object is reached in time" );
+	}
+
+	flag.set = false;
+	step = 2;
+
+	// flag set after the timeout expired, but before the scheduler checked
+	{
+		const YIELD & r = co_yield YIELD( flag, 5ms );
+
+		check( r.wakeup_reason == YIELD::WakeupReason::OBJECT, "object wins over an expired timeout" );
+	}
+
+	flag.set = true;
+
+	// already reached, when yielding
+	{
+		const YIELD & r = co_yield YIELD( flag, 1s );
+
+		check( r.wakeup_reason == YIELD::WakeupReason::OBJECT, "object already reached" );
+	}
+
+	step = 3;
+}
+
+template<class Predicate> bool schedule_until( Predicate predicate )
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	while( !predicate() ) {
+		if( std::chrono::steady_clock::now() - start > 5s ) {
+			return false;
+		}
+
+		if( !sch.schedule() ) {
+			sch.idle();
+		}
+	}
+
+	return true;
+}
+
+int main( int argc, char **argv )
+{
+	Tools::x_debug = new OutDebug();
+
+	try {
+		auto task_waiter = waiter();
+		sch.add_task_reference( task_waiter );
+
+		check( schedule_until( []() { return step == 1; } ), "first wait done" );
+
+		sch.schedule();
+		flag.set = true;
+
+		check( schedule_until( []() { return step == 2; } ), "second wait done" );
+
+		// the waiter is suspended on the third wait now
+		sch.schedule();
+		std::this_thread::sleep_for( 10ms );
+		flag.set = true;
+
+		check( schedule_until( []() { return step == 3; } ), "all waits done" );
+
+	} catch( const std::exception & error ) {
+		std::cout << "Error: " << error.what() << std::endl;
+		return 1;
+	}
+
+	return result();
+}
@@ -0,0 +1,209 @@
+/**
+ * send_file() and splice_fd() from a file to a socket,
+ * the other end of the socket pair is read by a thread
+ * @author Copyright (c) 2024 Martin Oberzalek
+ */
+#include <iostream>
+#include <OutDebug.h>
+#include <format.h>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "coscheduler/CoScheduler.hpp"
+#include "coscheduler/CoGenerator.hpp"
+#include "coscheduler/CoReactor.hpp"
+#include "coscheduler/CoTransfer.hpp"
+#include "TestCheck.h"
+
+using namespace std::chrono_literals;
+using namespace Tools;
+using namespace TestCheck;
+
+struct ReactorConf
+{
+	using yield_type = CoScheduler::CoGenerator<CoScheduler::YIELD>;
+
+	using CONTAINER_TASKS            = std::vector<yield_type*>;
+	using CONTAINER_WAITABLE_OBJECTS = std::vector<CoScheduler::WaitForBase*>;
+	using CONTAINER_WAIT_OBJECTS     = std::vector<CoScheduler::WaitForBase*>;
+
+	using IDLE_WAITER = CoScheduler::Reactor;
+
+	inline static void idle( IDLE_WAITER & waiter, std::chrono::nanoseconds timeout )
+	{
+		waiter.wait_for( timeout );
+	}
+};
+
+using Scheduler = CoScheduler::Scheduler<ReactorConf>;
+using YIELD = CoScheduler::YIELD;
+
+static constexpr std::size_t FILE_SIZE = 1024 * 1024 + 123;
+
+Scheduler sch;
+bool finished = false;
+
+// unlinked temporary file with a known content
+class DataFile
+{
+public:
+	int fd = -1;
+	std::string content;
+
+	DataFile()
+	{
+		char name[] = "/tmp/test_transferXXXXXX";
+		fd = mkstemp( name );
+
+		if( fd < 0 ) {
+			throw std::system_error( errno, std::generic_category(), "mkstemp" );
+		}
+
+		unlink( name );
+
+		content.resize( FILE_SIZE );
+
+		for( std::size_t i = 0; i < content.size(); i++ ) {
+			content[i] = static_cast<char>( 'a' + i % 23 );
+		}
+
+		if( write( fd, content.data(), content.size() ) != static_cast<ssize_t>( content.size() ) ) {
+			throw std::system_error( errno, std::generic_category(), "write" );
+		}
+	}
+
+	~DataFile() {
+		close( fd );
+	}
+};
+
+class SocketPair
+{
+public:
+	int fds[2] = { -1, -1 };
+
+	SocketPair()
+	{
+		if( socketpair( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds ) != 0 ) {
+			throw std::system_error( errno, std::generic_category(), "socketpair" );
+		}
+
+		// only the sending end is non blocking
+		fcntl( fds[0], F_SETFL, fcntl( fds[0], F_GETFL ) | O_NONBLOCK );
+	}
+
+	~SocketPair() {
+		close( fds[0] );
+		close( fds[1] );
+	}
+};
+
+std::string read_all( int fd, std::size_t expected )
+{
+	std::string data;
+	char buffer[16 * 1024];
+
+	while( data.size() < expected ) {
+		const ssize_t len = read( fd, buffer, sizeof(buffer) );
+
+		if( len <= 0 ) {
+			break;
+		}
+
+		data.append( buffer, static_cast<std::size_t>( len ) );
+	}
+
+	return data;
+}
+
+Scheduler::yield_type sender( CoScheduler::FdWaiter & out, int file_fd, off_t offset, std::size_t count,
+							  CoScheduler::TransferResult & result, bool use_splice )
+{
+	if( use_splice ) {
+		lseek( file_fd, offset, SEEK_SET );
+
+		auto tx = CoScheduler::splice_fd<Scheduler::yield_type>( file_fd, nullptr, out, count, result, 16 * 1024 );
+
+		while( tx ) {
+			co_yield tx();
+		}
+	} else {
+		auto tx = CoScheduler::send_file<Scheduler::yield_type>( out, file_fd, offset, count, result, 16 * 1024 );
+
+		while( tx ) {
+			co_yield tx();
+		}
+	}
+
+	finished = true;
+}
+
+void transfer( DataFile & file, off_t offset, std::size_t count, bool use_splice )
+{
+	const std::string name = use_splice ? "splice_fd" : "send_file";
+	const std::size_t expected = std::min( count, FILE_SIZE - static_cast<std::size_t>( offset ) );
+
+	SocketPair sockets;
+	CoScheduler::FdWaiter out( sch.get_idle_waiter(), sockets.fds[0] );
+	CoScheduler::TransferResult result;
+	std::string received;
+
+	// the socket buffer is smaller than the file, so the sender has to wait
+	std::thread receiver( [&sockets,&received,expected]() {
+		std::this_thread::sleep_for( 10ms );
+		received = read_all( sockets.fds[1], expected );
+	});
+
+	finished = false;
+
+	auto task = sender( out, file.fd, offset, count, result, use_splice );
+	sch.add_task_reference( task );
+
+	const auto start = std::chrono::steady_clock::now();
+
+	while( !finished && std::chrono::steady_clock::now() - start < 5s ) {
+		if( !sch.schedule() ) {
+			sch.idle();
+		}
+	}
+
+	if( !finished ) {
+		// unblock the receiver
+		shutdown( sockets.fds[0], SHUT_WR );
+	}
+
+	receiver.join();
+
+	check( finished, name + ": transfer finished" );
+	check( result.error == 0, format( "%s: no error (%d)", name, result.error ) );
+	check( result.transferred == expected, format( "%s: %d of %d bytes transferred", name, result.transferred, expected ) );
+	check( received == file.content.substr( static_cast<std::size_t>( offset ), expected ), name + ": data received unchanged" );
+}
+
+int main( int argc, char **argv )
+{
+	Tools::x_debug = new OutDebug();
+
+	try {
+		DataFile file;
+
+		transfer( file, 0, FILE_SIZE, false );
+		transfer( file, 1000, 100 * 1024, false );
+		// stops at the end of the file
+		transfer( file, 4096, 2 * FILE_SIZE, false );
+
+		transfer( file, 0, FILE_SIZE, true );
+		transfer( file, 4096, 2 * FILE_SIZE, true );
+
+	} catch( const std::exception & error ) {
+		std::cout << "Error: " << error.what() << std::endl;
+		return 1;
+	}
+
+	return result();
+}
@@ -0,0 +1,179 @@
+/**
+ * IoUring as idle waiter: reading a pipe, timeout and abandon
+ * of a request, destruction of the ring with requests in flight
+ * @author Copyright (c) 2024 Martin Oberzalek
+ */
+#include <iostream>
+#include <OutDebug.h>
+#include <format.h>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "coscheduler/CoScheduler.hpp"
+#include "coscheduler/CoGenerator.hpp"
+#include "coscheduler/CoIoUring.hpp"
+#include "TestCheck.h"
+
+using namespace std::chrono_literals;
+using namespace Tools;
+using namespace TestCheck;
+
+struct UringConf
+{
+	using yield_type = CoScheduler::CoGenerator<CoScheduler::YIELD>;
+
+	using CONTAINER_TASKS            = std::vector<yield_type*>;
+	using CONTAINER_WAITABLE_OBJECTS = std::vector<CoScheduler::WaitForBase*>;
+	using CONTAINER_WAIT_OBJECTS     = std::vector<CoScheduler::WaitForBase*>;
+
+	using IDLE_WAITER = CoScheduler::IoUring;
+
+	inline static void idle( IDLE_WAITER & waiter, std::chrono::nanoseconds timeout )
+	{
+		waiter.wait_for( timeout );
+	}
+};
+
+using Scheduler = CoScheduler::Scheduler<UringConf>;
+using YIELD = CoScheduler::YIELD;
+
+int finished = 0;
+
+class Pipe
+{
+public:
+	int fds[2] = { -1, -1 };
+
+	Pipe() {
+		if( pipe( fds ) != 0 ) {
+			throw std::system_error( errno, std::generic_category(), "pipe" );
+		}
+	}
+
+	~Pipe() {
+		close( fds[0] );
+		close( fds[1] );
+	}
+
+	int read_end() const {
+		return fds[0];
+	}
+
+	int write_end() const {
+		return fds[1];
+	}
+};
+
+Scheduler::yield_type read_pipe( Scheduler & sch, Pipe & pipe )
+{
+	char buffer[32] = {};
+	auto read = CoScheduler::async_read( sch.get_idle_waiter(), pipe.read_end(), buffer, sizeof(buffer), 0 );
+
+	co_yield YIELD( read );
+
+	check( read.result() == 5, format( "read %d bytes from the pipe", read.result() ) );
+	check( std::string( buffer, std::max( read.result(), 0 ) ) == "hello", "pipe content received" );
+
+	const char *answer = "world";
+	auto write = CoScheduler::async_write( sch.get_idle_waiter(), pipe.write_end(), answer, strlen( answer ), 0 );
+
+	co_yield YIELD( write );
+
+	check( write.result() == 5, format( "wrote %d bytes into the pipe", write.result() ) );
+	finished++;
+}
+
+Scheduler::yield_type read_timeout( Scheduler & sch, Pipe & pipe )
+{
+	char buffer[32] = {};
+
+	{
+		auto read = CoScheduler::async_read( sch.get_idle_waiter(), pipe.read_end(), buffer, sizeof(buffer), 0 );
+
+		const YIELD & r = co_yield YIELD( read, 30ms );
+
+		check( r.timed_out(), "nothing written, read timed out" );
+		check( !read.condition_reached(), "read still pending after the timeout" );
+
+		// the request is abandoned here, the kernel cancels the read
+	}
+
+	// the canceled read must not have taken any data
+	const char *text = "late";
+	check( ::write( pipe.write_end(), text, 4 ) == 4, "written after abandon" );
+	check( ::read( pipe.read_end(), buffer, sizeof(buffer) ) == 4, "data is still in the pipe" );
+	finished++;
+}
+
+int main( int argc, char **argv )
+{
+	Tools::x_debug = new OutDebug();
+
+	try {
+		Scheduler sch;
+
+		Pipe pipe_data;
+		Pipe pipe_timeout;
+
+		std::thread writer( [&pipe_data]() {
+			std::this_thread::sleep_for( 20ms );
+			[[maybe_unused]] auto ret = ::write( pipe_data.write_end(), "hello", 5 );
+		});
+
+		auto task_read = read_pipe( sch, pipe_data );
+		auto task_timeout = read_timeout( sch, pipe_timeout );
+
+		sch.add_task_reference( task_read );
+		sch.add_task_reference( task_timeout );
+
+		const auto start = std::chrono::steady_clock::now();
+
+		while( finished < 2 && std::chrono::steady_clock::now() - start < 5s ) {
+			sch.schedule();
+		}
+
+		writer.join();
+
+		check( finished == 2, "all tasks finished" );
+
+		char answer[8] = {};
+		check( ::read( pipe_data.read_end(), answer, sizeof(answer) ) == 5
+			   && std::string( answer, 5 ) == "world", "async_write reached the pipe" );
+
+		// a request, that outlives its ring
+		Pipe pipe_pending;
+		char buffer[8];
+		CoScheduler::IoRequest *pending = nullptr;
+
+		{
+			CoScheduler::IoUring ring;
+			pending = new CoScheduler::IoRequest( ring, IORING_OP_READ, pipe_pending.read_end(), buffer, sizeof(buffer), 0 );
+			ring.poll();
+
+			check( !pending->condition_reached(), "read on an empty pipe is in flight" );
+		}
+
+		check( pending->condition_reached() && pending->result() == -ECANCELED,
+			   format( "ring destroyed, request canceled with %d", pending->result() ) );
+
+		delete pending;
+
+	} catch( const std::system_error & error ) {
+		if( error.code().value() == ENOSYS || error.code().value() == EPERM ) {
+			std::cout << "io_uring not available: " << error.what() << std::endl;
+			// automake: test skipped
+			return 77;
+		}
+
+		std::cout << "Error: " << error.what() << std::endl;
+		return 1;
+	} catch( const std::exception & error ) {
+		std::cout << "Error: " << error.what() << std::endl;
+		return 1;
+	}
+
+	return result();
+}
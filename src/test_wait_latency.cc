@@ -0,0 +1,94 @@
+/**
+ * A wait object, changed by an other thread without wakeup(),
+ * is noticed after Conf::MAX_IDLE
+ * @author Copyright (c) 2024 Martin Oberzalek
+ */
+#include <iostream>
+#include <OutDebug.h>
+#include <format.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "coscheduler/CoScheduler.hpp"
+#include "coscheduler/CoGenerator.hpp"
+#include "CoSchedulerDynamicConf.h"
+#include "TestCheck.h"
+
+using namespace std::chrono_literals;
+using namespace Tools;
+using namespace TestCheck;
+
+using Scheduler = CoScheduler::Scheduler<DynamicConf>;
+using YIELD = CoScheduler::YIELD;
+
+static constexpr int ROUNDS = 20;
+
+// set like by an interrupt handler, without waking up the scheduler
+class Flag : public CoScheduler::WaitForBase
+{
+public:
+	std::atomic<bool> set = false;
+	std::atomic<std::chrono::steady_clock::rep> set_at = 0;
+
+	bool condition_reached() const override {
+		return set.load( std::memory_order_acquire );
+	}
+};
+
+Scheduler sch;
+Flag flag;
+std::atomic<int> round_done = 0;
+std::chrono::nanoseconds max_latency{};
+
+Scheduler::yield_type waiter()
+{
+	for( int i = 0; i < ROUNDS; i++ ) {
+		co_yield YIELD( flag );
+
+		const std::chrono::steady_clock::duration set_at( flag.set_at.load() );
+		const auto latency = std::chrono::steady_clock::now().time_since_epoch() - set_at;
+		max_latency = std::max<std::chrono::nanoseconds>( max_latency, latency );
+
+		flag.set = false;
+		round_done++;
+	}
+
+	sch.stop();
+}
+
+int main( int argc, char **argv )
+{
+	Tools::x_debug = new OutDebug();
+
+	try {
+		std::thread setter( []() {
+			for( int i = 0; i < ROUNDS; i++ ) {
+				// the scheduler is idle by now
+				std::this_thread::sleep_for( 30ms );
+
+				flag.set_at = std::chrono::steady_clock::now().time_since_epoch().count();
+				flag.set = true;
+
+				while( round_done <= i ) {
+					std::this_thread::sleep_for( 1ms );
+				}
+			}
+		});
+
+		auto task_waiter = waiter();
+		sch.add_task_reference( task_waiter );
+
+		sch.infinite_schedule();
+		setter.join();
+
+		check( max_latency < 50ms, format( "flag noticed after %dus at most",
+										   std::chrono::duration_cast<std::chrono::microseconds>( max_latency ).count() ) );
+
+	} catch( const std::exception & error ) {
+		std::cout << "Error: " << error.what() << std::endl;
+		return 1;
+	}
+
+	return result();
+}
@@ -0,0 +1,123 @@
+/**
+ * Watchdog: a task exceeding its budget is reported once, with the
+ * backtrace of the scheduler thread, tasks within their budget are not
+ * @author Copyright (c) 2024 Martin Oberzalek
+ */
+#include <iostream>
+#include <OutDebug.h>
+#include <format.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "coscheduler/CoScheduler.hpp"
+#include "coscheduler/CoGenerator.hpp"
+#include "coscheduler/CoWatchdog.hpp"
+#include "CoSchedulerDynamicConf.h"
+#include "TestCheck.h"
+
+using namespace std::chrono_literals;
+using namespace Tools;
+using namespace TestCheck;
+
+using Scheduler = CoScheduler::Scheduler<DynamicConf>;
+using YIELD = CoScheduler::YIELD;
+
+Scheduler sch;
+int finished = 0;
+
+class RecordingWatchdog : public CoScheduler::Watchdog<Scheduler>
+{
+public:
+	std::mutex m;
+	std::vector<CoScheduler::WatchdogReport> reports;
+
+	RecordingWatchdog( Scheduler & scheduler, const CoScheduler::WatchdogOptions & options )
+	: Watchdog<Scheduler>( scheduler, options )
+	{}
+
+protected:
+	void on_overrun( const CoScheduler::WatchdogReport & report ) override
+	{
+		std::lock_guard<std::mutex> lock( m );
+		reports.push_back( report );
+	}
+};
+
+void busy_for( std::chrono::milliseconds duration )
+{
+	const auto end = std::chrono::steady_clock::now() + duration;
+
+	while( std::chrono::steady_clock::now() < end ) {
+	}
+}
+
+const void *stalling_task = nullptr;
+
+Scheduler::yield_type stall()
+{
+	co_yield YIELD( 1ms );
+
+	// budget 10ms
+	busy_for( 60ms );
+	finished++;
+}
+
+Scheduler::yield_type within_expected()
+{
+	co_yield YIELD( 1ms, 200ms );
+
+	busy_for( 30ms );
+	finished++;
+}
+
+int main( int argc, char **argv )
+{
+	Tools::x_debug = new OutDebug();
+
+	try {
+		CoScheduler::WatchdogOptions options;
+		options.budget = 10ms;
+		options.check_interval = 2ms;
+
+		RecordingWatchdog watchdog( sch, options );
+
+		auto task_stall = stall();
+		auto task_expected = within_expected();
+		stalling_task = &task_stall;
+
+		sch.add_task_reference( task_stall );
+		sch.add_task_reference( task_expected );
+
+		const auto start = std::chrono::steady_clock::now();
+
+		while( finished < 2 && std::chrono::steady_clock::now() - start < 5s ) {
+			if( !sch.schedule() ) {
+				sch.idle();
+			}
+		}
+
+		check( finished == 2, "all tasks finished" );
+
+		std::lock_guard<std::mutex> lock( watchdog.m );
+
+		check( watchdog.reports.size() == 1, format( "%d overruns reported", watchdog.reports.size() ) );
+
+		if( !watchdog.reports.empty() ) {
+			const CoScheduler::WatchdogReport & report = watchdog.reports.front();
+
+			check( report.task == stalling_task, "the stalling task is reported" );
+			check( report.budget == 10ms, "default budget applied" );
+			check( report.running > 10ms, format( "running for %dms", std::chrono::duration_cast<std::chrono::milliseconds>( report.running ).count() ) );
+			check( report.task_count == 2, "task count of the scheduler" );
+			check( !report.backtrace.empty(), format( "backtrace with %d frames", report.backtrace.size() ) );
+		}
+
+	} catch( const std::exception & error ) {
+		std::cout << "Error: " << error.what() << std::endl;
+		return 1;
+	}
+
+	return result();
+}
@@ -0,0 +1,115 @@
+/**
+ * Sub coroutines run concurrently with when_all() and when_any()
+ * @author Copyright (c) 2024 Martin Oberzalek
+ */
+#include <iostream>
+#include <OutDebug.h>
+#include <format.h>
+#include <chrono>
+#include <string>
+#include "coscheduler/CoScheduler.hpp"
+#include "coscheduler/CoGenerator.hpp"
+#include "coscheduler/CoWhen.hpp"
+#include "coscheduler/CoLatch.hpp"
+#include "CoSchedulerDynamicConf.h"
+#include "TestCheck.h"
+
+using namespace std::chrono_literals;
+using namespace Tools;
+using namespace TestCheck;
+
+using Scheduler = CoScheduler::Scheduler<DynamicConf>;
+using YIELD = CoScheduler::YIELD;
+
+Scheduler sch;
+CoScheduler::latch released( 1 );
+
+// names of the steps, in the order they ran
+std::string steps;
+int destroyed = 0;
+
+struct CountDestroy
+{
+	~CountDestroy() {
+		destroyed++;
+	}
+};
+
+Scheduler::yield_type sub( char name, int count, std::chrono::milliseconds interval )
+{
+	CountDestroy count_destroy;
+
+	for( int i = 0; i < count; i++ ) {
+		steps += name;
+		co_yield YIELD( interval );
+	}
+}
+
+Scheduler::yield_type sub_latch( char name )
+{
+	CountDestroy count_destroy;
+
+	co_yield YIELD( released );
+	steps += name;
+}
+
+Scheduler::yield_type release_latch()
+{
+	co_yield YIELD( 30ms );
+	released.count_down();
+}
+
+Scheduler::yield_type test()
+{
+	{
+		const auto start = std::chrono::steady_clock::now();
+		auto all = CoScheduler::when_all( sub( 'a', 3, 10ms ), sub( 'b', 2, 15ms ), sub_latch( 'w' ) );
+
+		while( all ) {
+			co_yield all();
+		}
+
+		check( steps.find( 'b' ) < steps.rfind( 'a' ), "when_all: sub coroutines are interleaved: " + steps );
+		check( steps.back() == 'w', "when_all: waits for the latch: " + steps );
+		check( std::chrono::steady_clock::now() - start >= 30ms, "when_all: finished after the latch" );
+		check( destroyed == 3, format( "when_all: all sub coroutines destroyed: %d", destroyed ) );
+	}
+
+	steps.clear();
+	destroyed = 0;
+
+	{
+		auto any = CoScheduler::when_any( sub( 'c', 2, 10ms ), sub( 'd', 100, 10ms ) );
+
+		while( any ) {
+			co_yield any();
+		}
+
+		check( any.winner() == 0, format( "when_any: first one wins: %d", any.winner() ) );
+		check( destroyed == 2, format( "when_any: the other one is destroyed: %d", destroyed ) );
+		check( steps.size() < 10, "when_any: the other one stopped: " + steps );
+	}
+
+	sch.stop();
+}
+
+int main( int argc, char **argv )
+{
+	Tools::x_debug = new OutDebug();
+
+	try {
+		auto task_test = test();
+		auto task_release = release_latch();
+
+		sch.add_task_reference( task_test );
+		sch.add_task_reference( task_release );
+
+		sch.infinite_schedule();
+
+	} catch( const std::exception & error ) {
+		std::cout << "Error: " << error.what() << std::endl;
+		return 1;
+	}
+
+	return result();
+}
@@ -0,0 +1,313 @@
+/**
+ * Renders a binary trace log, written by CoScheduler::BinaryLog
+ * @author Copyright (c) 2024 Martin Oberzalek
+ */
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include "TimeFormat.h"
+#include "coscheduler/CoTraceLog.hpp"
+
+using namespace CoScheduler::TraceFile;
+
+namespace {
+
+struct Format
+{
+	std::string file;
+	unsigned    line;
+	std::string fmt;
+};
+
+struct Arg
+{
+	ArgType       type;
+	std::int64_t  i = 0;
+	std::uint64_t u = 0;
+	double        d = 0;
+	std::string   s;
+};
+
+template<class T> std::string printf_arg( const std::string & spec, T value )
+{
+	const int len = std::snprintf( nullptr, 0, spec.c_str(), value );
+
+	if( len <= 0 ) {
+		return std::string();
+	}
+
+	std::string ret( len + 1, '\0' );
+	std::snprintf( ret.data(), ret.size(), spec.c_str(), value );
+	ret.resize( len );
+
+	return ret;
+}
+
+/*
+ * %s accepts every type, like Tools::format() does,
+ * all other conversions are converted to the type of the argument
+ */
+std::string render_arg( const std::string & spec, char conversion, const Arg & arg )
+{
+	const bool is_float_conversion = std::strchr( "feEgGaA", conversion ) != nullptr;
+	const bool is_int_conversion = std::strchr( "diuxXoc", conversion ) != nullptr;
+
+	switch( arg.type )
+	{
+	case ARG_STRING:
+		return printf_arg( spec + "s", arg.s.c_str() );
+
+	case ARG_DOUBLE:
+		if( is_int_conversion ) {
+			return printf_arg( spec + "lld", static_cast<long long>( arg.d ) );
+		}
+		return printf_arg( spec + ( is_float_conversion ? std::string( 1, conversion ) : "g" ), arg.d );
+
+	case ARG_PTR:
+		return printf_arg( spec + "p", reinterpret_cast<void*>( static_cast<std::uintptr_t>( arg.u ) ) );
+
+	case ARG_INT:
+		if( is_float_conversion ) {
+			return printf_arg( spec + conversion, static_cast<double>( arg.i ) );
+		}
+		if( conversion == 'c' ) {
+			return printf_arg( spec + "c", static_cast<int>( arg.i ) );
+		}
+		if( is_int_conversion && conversion != 'd' && conversion != 'i' ) {
+			return printf_arg( spec + "ll" + conversion, static_cast<unsigned long long>( arg.i ) );
+		}
+		return printf_arg( spec + "lld", static_cast<long long>( arg.i ) );
+
+	case ARG_UINT:
+		if( is_float_conversion ) {
+			return printf_arg( spec + conversion, static_cast<double>( arg.u ) );
+		}
+		if( conversion == 'c' ) {
+			return printf_arg( spec + "c", static_cast<int>( arg.u ) );
+		}
+		if( is_int_conversion && conversion != 'd' && conversion != 'i' ) {
+			return printf_arg( spec + "ll" + conversion, static_cast<unsigned long long>( arg.u ) );
+		}
+		return printf_arg( spec + "llu", static_cast<unsigned long long>( arg.u ) );
+	}
+
+	return std::string();
+}
+
+std::string render( const std::string & fmt, const std::vector<Arg> & args )
+{
+	std::string ret;
+	std::size_t arg_idx = 0;
+
+	for( std::size_t i = 0; i < fmt.size(); i++ ) {
+
+		if( fmt[i] != '%' ) {
+			ret += fmt[i];
+			continue;
+		}
+
+		if( i + 1 < fmt.size() && fmt[i+1] == '%' ) {
+			ret += '%';
+			i++;
+			continue;
+		}
+
+		// flags, width and precision are kept, length modifiers are dropped
+		std::string spec = "%";
+		std::size_t pos = i + 1;
+
+		while( pos < fmt.size() && std::strchr( "-+ #0123456789.", fmt[pos] ) ) {
+			spec += fmt[pos++];
+		}
+
+		while( pos < fmt.size() && std::strchr( "hlqLjzt", fmt[pos] ) ) {
+			pos++;
+		}
+
+		if( pos >= fmt.size() ) {
+			ret += fmt.substr( i );
+			break;
+		}
+
+		const char conversion = fmt[pos];
+		i = pos;
+
+		if( arg_idx >= args.size() ) {
+			ret += "<missing>";
+			continue;
+		}
+
+		ret += render_arg( spec, conversion, args[arg_idx++] );
+	}
+
+	return ret;
+}
+
+template<class T> bool read_value( const std::vector<char> & data, std::size_t & pos, std::size_t end, T & value )
+{
+	if( pos + sizeof(T) > end ) {
+		return false;
+	}
+
+	std::memcpy( &value, data.data() + pos, sizeof(T) );
+	pos += sizeof(T);
+
+	return true;
+}
+
+bool read_args( const std::vector<char> & data, std::size_t pos, std::size_t end, std::vector<Arg> & args )
+{
+	while( pos < end ) {
+		Arg arg;
+		std::uint8_t type = 0;
+
+		if( !read_value( data, pos, end, type ) ) {
+			return false;
+		}
+
+		arg.type = static_cast<ArgType>( type );
+
+		switch( arg.type )
+		{
+		case ARG_INT:
+			if( !read_value( data, pos, end, arg.i ) ) {
+				return false;
+			}
+			break;
+
+		case ARG_UINT:
+		case ARG_PTR:
+			if( !read_value( data, pos, end, arg.u ) ) {
+				return false;
+			}
+			break;
+
+		case ARG_DOUBLE:
+			if( !read_value( data, pos, end, arg.d ) ) {
+				return false;
+			}
+			break;
+
+		case ARG_STRING:
+		{
+			std::uint16_t len = 0;
+
+			if( !read_value( data, pos, end, len ) || pos + len > end ) {
+				return false;
+			}
+
+			arg.s.assign( data.data() + pos, len );
+			pos += len;
+			break;
+		}
+
+		default:
+			// padding at the end of the record
+			return true;
+		}
+
+		args.push_back( arg );
+	}
+
+	return true;
+}
+
+} // namespace
+
+int main( int argc, char **argv )
+{
+	if( argc != 2 ) {
+		std::cerr << "usage: " << argv[0] << " TRACEFILE" << std::endl;
+		return 1;
+	}
+
+	std::ifstream in( argv[1], std::ios::binary );
+
+	if( !in ) {
+		std::cerr << "cannot open " << argv[1] << std::endl;
+		return 1;
+	}
+
+	const std::vector<char> data( (std::istreambuf_iterator<char>( in )), std::istreambuf_iterator<char>() );
+
+	TraceHeader header{};
+
+	if( data.size() < sizeof(header) ) {
+		std::cerr << "file too short" << std::endl;
+		return 1;
+	}
+
+	std::memcpy( &header, data.data(), sizeof(header) );
+
+	if( std::memcmp( header.magic, MAGIC, sizeof(MAGIC) ) != 0 || header.version != VERSION ) {
+		std::cerr << "not a trace file, or unsupported version" << std::endl;
+		return 1;
+	}
+
+	const std::size_t ring_start = ring_offset( header.string_table_size );
+
+	if( data.size() < ring_start + header.ring_size || header.ring_size == 0 ) {
+		std::cerr << "file truncated" << std::endl;
+		return 1;
+	}
+
+	std::vector<Format> formats;
+
+	for( std::size_t pos = string_table_offset(), end = pos + header.string_table_used;
+		 pos < end && formats.size() < header.format_count; ) {
+
+		TraceFormat entry{};
+		std::memcpy( &entry, data.data() + pos, sizeof(entry) );
+
+		Format format;
+		format.line = entry.line;
+		format.file.assign( data.data() + pos + sizeof(entry), entry.file_len );
+		format.fmt.assign( data.data() + pos + sizeof(entry) + entry.file_len, entry.fmt_len );
+		formats.push_back( format );
+
+		pos += align8( sizeof(entry) + entry.file_len + entry.fmt_len );
+	}
+
+	for( std::uint64_t pos = header.tail; pos < header.head; ) {
+
+		const std::size_t offset = ring_start + pos % header.ring_size;
+		TraceRecord record{};
+		std::memcpy( &record, data.data() + offset, sizeof(record.size) + sizeof(record.id) );
+
+		if( record.size < sizeof(record.size) + sizeof(record.id) ) {
+			std::cerr << "corrupt record at position " << pos << std::endl;
+			return 1;
+		}
+
+		pos += record.size;
+
+		if( record.id == PADDING_ID ) {
+			continue;
+		}
+
+		std::memcpy( &record, data.data() + offset, sizeof(record) );
+
+		if( record.id >= formats.size() ) {
+			std::cerr << "unknown format id " << record.id << std::endl;
+			continue;
+		}
+
+		std::vector<Arg> args;
+		read_args( data, offset + sizeof(record), offset + record.size, args );
+
+		const Format & format = formats[record.id];
+		const std::chrono::system_clock::time_point tp( std::chrono::duration_cast<std::chrono::system_clock::duration>(
+				std::chrono::nanoseconds( record.timestamp ) ) );
+
+		std::cout << to_hhmmssms( tp ) << " "
+				  << format.file << ":" << format.line << " "
+				  << render( format.fmt, args ) << "\n";
+	}
+
+	return 0;
+}